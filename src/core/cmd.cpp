@@ -1,5 +1,6 @@
 #include "cmd.h"
 
+#include "module.h"
 #include "util/util.h"
 
 namespace kim {
@@ -11,11 +12,67 @@ Cmd::Cmd(Log* logger, INet* n, uint64_t id, const std::string& name)
     set_active_time(net()->now());
 }
 
-Cmd::~Cmd() { SAFE_DELETE(m_req); }
+Cmd::~Cmd() {
+    if (m_is_req_owner) {
+        SAFE_DELETE(m_req);
+    }
+}
 
 void Cmd::set_req(const Request& req) {
-    SAFE_DELETE(m_req);
+    if (m_is_req_owner) {
+        SAFE_DELETE(m_req);
+    }
+
+    if (req.arena() != nullptr) {
+        /* borrow it, the arena moves to cmd in hold_req(), when cmd is async. */
+        m_req = const_cast<Request*>(&req);
+        m_is_req_owner = false;
+        return;
+    }
+
     m_req = new Request(req);
+    m_is_req_owner = true;
+}
+
+void Cmd::hold_req() {
+    if (m_req != nullptr && !m_is_req_owner) {
+        m_req = new Request(std::move(*m_req));
+        m_is_req_owner = true;
+    }
+}
+
+void Cmd::reset() {
+    if (m_is_req_owner) {
+        SAFE_DELETE(m_req);
+    }
+    m_req = nullptr;
+    m_is_req_owner = true;
+    m_step = 0;
+    m_module = nullptr;
+    m_timer = nullptr;
+    m_cur_timeout_cnt = 0;
+    set_keep_alive(CMD_TIMEOUT_VAL);
+    set_max_timeout_cnt(CMD_MAX_TIMEOUT_CNT);
+}
+
+void Cmd::release(Cmd* cmd) {
+    if (cmd == nullptr) {
+        return;
+    }
+
+    /* cmd's code may be in module's so, release the module after it. */
+    Module* module = cmd->module();
+    cmd->set_module(nullptr);
+
+    if (cmd->pool() != nullptr) {
+        cmd->pool()->put(cmd);
+    } else {
+        delete cmd;
+    }
+
+    if (module != nullptr) {
+        module->del_cmd_ref();
+    }
 }
 
 bool Cmd::response_http(const std::string& data, int status_code) {
@@ -30,6 +87,7 @@ bool Cmd::response_http(const std::string& data, int status_code) {
     msg.set_status_code(status_code);
     msg.set_http_major(req_msg->http_major());
     msg.set_http_minor(req_msg->http_minor());
+    msg.set_seq(req_msg->seq());
     msg.set_body(data);
 
     if (!m_net->send_to(m_req->fd_data(), msg)) {
@@ -121,4 +179,61 @@ Cmd::STATUS Cmd::on_timeout() {
     // return response_http(ERR_EXEC_CMD_TIMEUOT, "request handle timeout!");
 }
 
+////////////////////////////////////////////////
+
+CmdPool::CmdPool(const std::string& name, size_t max_free_cnt)
+    : m_name(name), m_max_free_cnt(max_free_cnt) {
+}
+
+CmdPool::~CmdPool() {
+    for (auto cmd : m_free) {
+        delete cmd;
+    }
+    m_free.clear();
+}
+
+Cmd* CmdPool::get() {
+    if (m_free.empty()) {
+        m_miss_cnt++;
+        return nullptr;
+    }
+
+    Cmd* cmd = m_free.back();
+    m_free.pop_back();
+    m_used_cnt++;
+    m_hit_cnt++;
+    return cmd;
+}
+
+void CmdPool::put(Cmd* cmd) {
+    if (m_used_cnt > 0) {
+        m_used_cnt--;
+    }
+
+    if (m_is_closed || m_free.size() >= m_max_free_cnt) {
+        cmd->set_pool(nullptr);
+        delete cmd;
+        if (m_is_closed && m_used_cnt == 0) {
+            delete this;
+        }
+        return;
+    }
+
+    cmd->reset();
+    m_free.push_back(cmd);
+}
+
+void CmdPool::close() {
+    for (auto cmd : m_free) {
+        delete cmd;
+    }
+    m_free.clear();
+
+    if (m_used_cnt == 0) {
+        delete this;
+    } else {
+        m_is_closed = true;
+    }
+}
+
 }  // namespace kim
\ No newline at end of file
@@ -10,6 +10,9 @@
 
 namespace kim {
 
+class CmdPool;
+class Module;
+
 class Cmd : public Timer, public Base {
    public:
     enum class STATUS {
@@ -26,6 +29,8 @@ class Cmd : public Timer, public Base {
     CJsonObject& config() { return m_net->config(); }
 
     void set_req(const Request& req);
+    /* cmd is async, keep the request which is borrowed by set_req. */
+    void hold_req();
     const Request* req() const { return m_req; }
     Request* req() { return m_req; }
 
@@ -35,6 +40,17 @@ class Cmd : public Timer, public Base {
     void set_next_step(int step = -1) { m_step = (step != -1) ? step : (m_step + 1); }
     Cmd::STATUS execute_next_step(int err, void* data, int step = -1);
 
+    /* pooled cmd is reset before it goes back to pool, the derived cmd
+     * which keeps its own state should override it, and call Cmd::reset(). */
+    virtual void reset();
+    void set_pool(CmdPool* pool) { m_pool = pool; }
+    CmdPool* pool() { return m_pool; }
+    /* cmd goes back to its pool, or it is deleted. */
+    static void release(Cmd* cmd);
+    /* module which runs cmd, its so is kept until cmd is released. */
+    void set_module(Module* module) { m_module = module; }
+    Module* module() { return m_module; }
+
    public:
     virtual bool init() { return true; }
     virtual Cmd::STATUS on_timeout();
@@ -57,6 +73,46 @@ class Cmd : public Timer, public Base {
    protected:
     int m_step = 0;  // async step.
     Request* m_req = nullptr;
+    bool m_is_req_owner = true;
+    CmdPool* m_pool = nullptr;
+    Module* m_module = nullptr;
+};
+
+/* free list of one cmd type, owned by module. */
+class CmdPool {
+   public:
+    enum {
+        DEFAULT_MAX_FREE_CNT = 256,
+    };
+
+    CmdPool(const std::string& name, size_t max_free_cnt = DEFAULT_MAX_FREE_CNT);
+    virtual ~CmdPool();
+
+    CmdPool(const CmdPool&) = delete;
+    CmdPool& operator=(const CmdPool&) = delete;
+
+    /* nullptr: free list is empty, caller creates a new one. */
+    Cmd* get();
+    void put(Cmd* cmd);
+    /* the cmds created by caller. */
+    void add_used() { m_used_cnt++; }
+    /* module is gone, pool is deleted when its last cmd is back. */
+    void close();
+
+    const std::string& name() const { return m_name; }
+    uint64_t hit_cnt() const { return m_hit_cnt; }
+    uint64_t miss_cnt() const { return m_miss_cnt; }
+    size_t free_cnt() const { return m_free.size(); }
+    size_t used_cnt() const { return m_used_cnt; }
+
+   private:
+    std::string m_name;
+    size_t m_max_free_cnt = DEFAULT_MAX_FREE_CNT;
+    std::vector<Cmd*> m_free;
+    size_t m_used_cnt = 0;
+    uint64_t m_hit_cnt = 0;
+    uint64_t m_miss_cnt = 0;
+    bool m_is_closed = false;
 };
 
 }  // namespace kim
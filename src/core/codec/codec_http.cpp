@@ -73,6 +73,18 @@ namespace kim {
 
 CodecHttp::CodecHttp(Log* logger, Codec::TYPE type, double keep_alive)
     : Codec(logger, type), m_keep_alive(keep_alive) {
+    memset(&m_parser_setting, 0, sizeof(m_parser_setting));
+    m_parser_setting.on_message_begin = on_message_begin;
+    m_parser_setting.on_url = on_url;
+    m_parser_setting.on_status = on_status;
+    m_parser_setting.on_header_field = on_header_field;
+    m_parser_setting.on_header_value = on_header_value;
+    m_parser_setting.on_headers_complete = on_headers_complete;
+    m_parser_setting.on_body = on_body;
+    m_parser_setting.on_message_complete = on_message_complete;
+    m_parser_setting.on_chunk_header = on_chunk_header;
+    m_parser_setting.on_chunk_complete = on_chunk_complete;
+    reset_parser();
 }
 
 CodecHttp::~CodecHttp() {
@@ -265,40 +277,80 @@ error:
     return Codec::STATUS::ERR;
 }
 
+void CodecHttp::reset_parser() {
+    http_parser_init(&m_parser, HTTP_BOTH);
+    m_parser.data = this;
+    m_decode_msg = nullptr;
+    m_is_partial = false;
+    m_partial_msg.Clear();
+    m_url.clear();
+    m_header_field.clear();
+    m_header_value.clear();
+    m_is_header_value = false;
+}
+
+/* move msg without copying the body, they maybe on different arenas. */
+static void move_msg(HttpMsg& from, HttpMsg& to) {
+    std::string body;
+    body.swap(*from.mutable_body());
+    to.CopyFrom(from);
+    to.mutable_body()->swap(body);
+    from.Clear();
+}
+
 Codec::STATUS CodecHttp::decode(SocketBuffer* sbuf, HttpMsg& msg) {
     if (!sbuf->is_readable()) {
         return Codec::STATUS::PAUSE;  // not enough data to decode.
     }
 
-    ++m_decode_cnt;
-    m_parser_setting.on_message_begin = on_message_begin;
-    m_parser_setting.on_url = on_url;
-    m_parser_setting.on_status = on_status;
-    m_parser_setting.on_header_field = on_header_field;
-    m_parser_setting.on_header_value = on_header_value;
-    m_parser_setting.on_headers_complete = on_headers_complete;
-    m_parser_setting.on_body = on_body;
-    m_parser_setting.on_message_complete = on_message_complete;
-    m_parser_setting.on_chunk_header = on_chunk_header;
-    m_parser_setting.on_chunk_complete = on_chunk_complete;
-    m_parser.data = &msg;
-    http_parser_init(&m_parser, HTTP_BOTH);
+    /* parser keeps its state between reads, only the new bytes are parsed,
+     * the decoding msg is kept in codec when the data is not enough. */
+    m_decode_msg = m_is_partial ? &m_partial_msg : &msg;
 
-    const char* buffer = sbuf->raw_read_buffer();
-    size_t buf_len = sbuf->readable_len();
-    size_t len = http_parser_execute(&m_parser, &m_parser_setting, buffer, buf_len);
+    size_t len, block;
+    bool is_complete = false;
 
-    if (msg.is_decoding()) {
-        return Codec::STATUS::PAUSE;
+    while (sbuf->is_readable()) {
+        block = sbuf->contiguous_len();
+        len = http_parser_execute(&m_parser, &m_parser_setting, sbuf->raw_read_buffer(), block);
+        sbuf->advance_read_index(len);
+
+        if (HTTP_PARSER_ERRNO(&m_parser) == HPE_PAUSED) {
+            /* paused by on_message_complete, one msg per decode. */
+            http_parser_pause(&m_parser, 0);
+            is_complete = true;
+            break;
+        }
+
+        if (HTTP_PARSER_ERRNO(&m_parser) != HPE_OK) {
+            LOG_WARN("parse http message failed! error: %s",
+                     http_errno_name((http_errno)m_parser.http_errno));
+            reset_parser();
+            return Codec::STATUS::ERR;
+        }
+
+        if (len < block) {
+            LOG_WARN("parse http message failed! upgrade is not supported!");
+            reset_parser();
+            return Codec::STATUS::ERR;
+        }
     }
 
-    if (m_parser.http_errno != HPE_OK) {
-        LOG_WARN("parse http message failed! error: %s",
-                 http_errno_name((http_errno)m_parser.http_errno));
-        return Codec::STATUS::ERR;
+    if (!is_complete) {
+        if (!m_is_partial && msg.is_decoding()) {
+            move_msg(msg, m_partial_msg);
+            m_is_partial = true;
+        }
+        m_decode_msg = nullptr;
+        return Codec::STATUS::PAUSE;
     }
 
-    sbuf->advance_read_index(len);
+    if (m_is_partial) {
+        move_msg(m_partial_msg, msg);
+        m_is_partial = false;
+    }
+    m_decode_msg = nullptr;
+    ++m_decode_cnt;
 
     if (msg.type() == HTTP_REQUEST) {
         m_http_major = msg.http_major();
@@ -324,23 +376,34 @@ Codec::STATUS CodecHttp::decode(SocketBuffer* sbuf, HttpMsg& msg) {
 }
 
 int CodecHttp::on_message_begin(http_parser* parser) {
-    HttpMsg* msg = (HttpMsg*)parser->data;
-    msg->set_is_decoding(true);
+    CodecHttp* codec = (CodecHttp*)parser->data;
+    codec->m_url.clear();
+    codec->m_header_field.clear();
+    codec->m_header_value.clear();
+    codec->m_is_header_value = false;
+    codec->m_decode_msg->set_is_decoding(true);
     return 0;
 }
 
+/* data callbacks maybe called more than once for one token, when the token
+ * is split by reading, so the token is appended. */
 int CodecHttp::on_url(http_parser* parser, const char* at, size_t len) {
-    HttpMsg* msg = (HttpMsg*)parser->data;
-    msg->set_url(at, len);
+    CodecHttp* codec = (CodecHttp*)parser->data;
+    codec->m_url.append(at, len);
+    return 0;
+}
+
+void CodecHttp::set_url(HttpMsg* msg, const std::string& url) {
+    const char* at = url.c_str();
+    size_t len = url.size();
     struct http_parser_url parser_url;
 
+    msg->set_url(url);
+
     if (http_parser_parse_url(at, len, 0, &parser_url) == 0) {
         if (parser_url.field_set & (1 << UF_PATH)) {
-            char* path = (char*)malloc(parser_url.field_data[UF_PATH].len);
-            strncpy(path, at + parser_url.field_data[UF_PATH].off,
-                    parser_url.field_data[UF_PATH].len);
-            msg->set_path(path, parser_url.field_data[UF_PATH].len);
-            free(path);
+            msg->set_path(at + parser_url.field_data[UF_PATH].off,
+                          parser_url.field_data[UF_PATH].len);
         }
 
         if (parser_url.field_set & (1 << UF_QUERY)) {
@@ -354,28 +417,36 @@ int CodecHttp::on_url(http_parser* parser, const char* at, size_t len) {
             }
         }
     }
-
-    return 0;
 }
 
 int CodecHttp::on_status(http_parser* parser, const char* at, size_t len) {
-    HttpMsg* msg = (HttpMsg*)parser->data;
-    msg->set_status_code(parser->status_code);
+    CodecHttp* codec = (CodecHttp*)parser->data;
+    codec->m_decode_msg->set_status_code(parser->status_code);
     return (0);
 }
 
 int CodecHttp::on_header_field(http_parser* parser, const char* at, size_t len) {
-    HttpMsg* msg = (HttpMsg*)parser->data;
-    msg->set_body(at, len);  // firstly header and then on_header_value get header's value.
+    CodecHttp* codec = (CodecHttp*)parser->data;
+    if (codec->m_is_header_value) {
+        // a new header begins, save the last one.
+        codec->add_header();
+    }
+    codec->m_header_field.append(at, len);
     return (0);
 }
 
 int CodecHttp::on_header_value(http_parser* parser, const char* at, size_t len) {
-    HttpMsg* msg = (HttpMsg*)parser->data;
-    std::string header = msg->body();
-    std::string value(at, len);
+    CodecHttp* codec = (CodecHttp*)parser->data;
+    codec->m_is_header_value = true;
+    codec->m_header_value.append(at, len);
+    return 0;
+}
+
+void CodecHttp::add_header() {
+    HttpMsg* msg = m_decode_msg;
+    const std::string& header = m_header_field;
+    const std::string& value = m_header_value;
 
-    msg->set_body("");
     (*msg->mutable_headers())[header] = value;
 
     if (header == "Keep-Alive") {
@@ -388,20 +459,25 @@ int CodecHttp::on_header_value(http_parser* parser, const char* at, size_t len)
         }
     }
 
-    return 0;
+    m_header_field.clear();
+    m_header_value.clear();
+    m_is_header_value = false;
 }
 
 int CodecHttp::on_body(http_parser* parser, const char* at, size_t len) {
-    HttpMsg* msg = (HttpMsg*)parser->data;
-    if (msg->body().size() > 0) {
-        msg->mutable_body()->append(at, len);
-    } else {
-        msg->set_body(at, len);
-    }
+    CodecHttp* codec = (CodecHttp*)parser->data;
+    codec->m_decode_msg->mutable_body()->append(at, len);
     return (0);
 }
 
 int CodecHttp::on_headers_complete(http_parser* parser) {
+    CodecHttp* codec = (CodecHttp*)parser->data;
+    if (codec->m_is_header_value) {
+        codec->add_header();
+    }
+    if (!codec->m_url.empty()) {
+        set_url(codec->m_decode_msg, codec->m_url);
+    }
     return 0;
 }
 
@@ -414,7 +490,7 @@ int CodecHttp::on_chunk_complete(http_parser* parser) {
 }
 
 int CodecHttp::on_message_complete(http_parser* parser) {
-    HttpMsg* msg = (HttpMsg*)parser->data;
+    HttpMsg* msg = ((CodecHttp*)parser->data)->m_decode_msg;
     if (parser->status_code != 0) {
         msg->set_status_code(parser->status_code);
         msg->set_type(HTTP_RESPONSE);
@@ -430,6 +506,8 @@ int CodecHttp::on_message_complete(http_parser* parser) {
         msg->set_keep_alive(0.0);
     }
 
+    /* stop parsing, the next pipelined msg is left in buffer. */
+    http_parser_pause(parser, 1);
     return 0;
 }
 
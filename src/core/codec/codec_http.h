@@ -37,6 +37,11 @@ class CodecHttp : public Codec {
     static int on_chunk_header(http_parser *parser);
     static int on_chunk_complete(http_parser *parser);
 
+   private:
+    void reset_parser();
+    void add_header();
+    static void set_url(HttpMsg *msg, const std::string &url);
+
    private:
     int m_http_major = 1;
     int m_http_minor = 1;
@@ -47,6 +52,15 @@ class CodecHttp : public Codec {
 
     http_parser m_parser;
     http_parser_settings m_parser_setting;
+
+    /* incremental decoding state, kept between reads. */
+    HttpMsg *m_decode_msg = nullptr; /* msg which callbacks fill. */
+    HttpMsg m_partial_msg;           /* uncompleted msg. */
+    bool m_is_partial = false;
+    std::string m_url;
+    std::string m_header_field;
+    std::string m_header_value;
+    bool m_is_header_value = false;
     std::unordered_map<std::string, std::string> m_http_headers;
 };
 
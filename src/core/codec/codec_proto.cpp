@@ -1,7 +1,5 @@
 #include "codec_proto.h"
 
-#define PROTO_MSG_HEAD_LEN 15
-
 namespace kim {
 
 CodecProto::CodecProto(Log* logger, Codec::TYPE codec)
@@ -15,31 +13,34 @@ CodecProto::encode(const MsgHead& head, const MsgBody& body, SocketBuffer* sbuf)
         return CodecProto::STATUS::ERR;
     }
 
-    size_t len = 0;
-    size_t write_len = 0;
-    size_t body_len = body.ByteSizeLong();
-
-    write_len = sbuf->_write(head.SerializeAsString().c_str(), PROTO_MSG_HEAD_LEN);
-    if (write_len != PROTO_MSG_HEAD_LEN) {
-        LOG_ERROR("encode head failed!, cmd: %d, seq: %d", head.cmd(), head.seq());
+    /* ByteSizeLong() caches the sizes for SerializeWithCachedSizesToArray(). */
+    size_t head_len = head.ByteSizeLong();
+    if (head_len > PROTO_MSG_HEAD_LEN) {
+        LOG_ERROR("invalid head len: %lu, cmd: %d, seq: %d", head_len, head.cmd(), head.seq());
         return CodecProto::STATUS::ERR;
     }
 
-    len += write_len;
+    // msg maybe has empty body, like heartbeat.
+    size_t body_len = (head.len() > 0) ? body.ByteSizeLong() : 0;
+    size_t len = PROTO_MSG_HEAD_LEN + body_len;
 
-    if (head.len() <= 0) {
-        // msg maybe has empty body, like heartbeat.
-        return CodecProto::STATUS::OK;
+    /* serialize in place, no temporary string. */
+    if (!sbuf->ensure_writeable(len)) {
+        LOG_ERROR("encode failed! alloc buffer failed! cmd: %d, seq: %d, len: %lu",
+                  head.cmd(), head.seq(), len);
+        return CodecProto::STATUS::ERR;
     }
 
-    write_len = sbuf->_write(body.SerializeAsString().c_str(), body_len);
-    if (write_len != body_len) {
-        LOG_ERROR("encode failed! cmd: %d, seq: %d, write len: %d, body len: %d",
-                  head.cmd(), head.seq(), write_len, body_len);
-        sbuf->set_write_index(sbuf->write_index() - len);
-        return CodecProto::STATUS::ERR;
+    uint8_t* data = (uint8_t*)sbuf->raw_write_buffer();
+    uint8_t* end = head.SerializeWithCachedSizesToArray(data);
+    /* zero fields are not serialized in proto3, fill the fixed head len. */
+    memset(end, 0, PROTO_MSG_HEAD_LEN - head_len);
+
+    if (body_len > 0) {
+        body.SerializeWithCachedSizesToArray(data + PROTO_MSG_HEAD_LEN);
     }
 
+    sbuf->advance_write_index(len);
     return CodecProto::STATUS::OK;
 }
 
@@ -58,7 +59,8 @@ Codec::STATUS CodecProto::decode(SocketBuffer* sbuf, MsgHead& head, MsgBody& bod
     }
 
     // parse msg head.
-    bool ret = head.ParseFromArray(sbuf->raw_read_buffer(), PROTO_MSG_HEAD_LEN);
+    const char* data = sbuf->make_contiguous(PROTO_MSG_HEAD_LEN);
+    bool ret = (data != nullptr) && head.ParseFromArray(data, PROTO_MSG_HEAD_LEN);
     if (!ret) {
         LOG_ERROR("decode head failed");
         return CodecProto::STATUS::ERR;
@@ -76,7 +78,8 @@ Codec::STATUS CodecProto::decode(SocketBuffer* sbuf, MsgHead& head, MsgBody& bod
         return CodecProto::STATUS::PAUSE;  // wait for more data to decode.
     }
 
-    ret = body.ParseFromArray(sbuf->raw_read_buffer() + PROTO_MSG_HEAD_LEN, head.len());
+    data = sbuf->make_contiguous(PROTO_MSG_HEAD_LEN + head.len());
+    ret = (data != nullptr) && body.ParseFromArray(data + PROTO_MSG_HEAD_LEN, head.len());
     if (!ret) {
         LOG_ERROR("cmd: %d, seq: %d, parse msg body failed!", head.cmd(), head.seq());
         return CodecProto::STATUS::ERR;
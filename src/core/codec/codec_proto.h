@@ -4,6 +4,8 @@
 #include "../server.h"
 #include "codec.h"
 
+#define PROTO_MSG_HEAD_LEN 15
+
 namespace kim {
 
 class CodecProto : public Codec {
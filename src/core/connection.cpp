@@ -2,6 +2,7 @@
 
 #include <unistd.h>
 
+#include "util/clock.h"
 #include "util/util.h"
 
 namespace kim {
@@ -17,6 +18,10 @@ Connection::~Connection() {
     SAFE_DELETE(m_recv_buf);
     SAFE_DELETE(m_send_buf);
     SAFE_DELETE(m_wait_send_buf);
+    for (auto& it : m_http_rsp_queue) {
+        delete it.second;
+    }
+    m_http_rsp_queue.clear();
 }
 
 bool Connection::init(Codec::TYPE codec) {
@@ -59,7 +64,7 @@ Codec::STATUS Connection::conn_read() {
         return Codec::STATUS::ERR;
     }
 
-    if ((CHECK_NEW(m_recv_buf, SocketBuffer)) == nullptr) {
+    if ((CHECK_NEW(m_recv_buf, SocketBuffer(m_segment_pool))) == nullptr) {
         return Codec::STATUS::ERR;
     }
 
@@ -82,8 +87,9 @@ Codec::STATUS Connection::conn_read() {
     } else {
         m_read_cnt++;
         m_read_bytes += read_len;
-        /* recovery socket buffer. */
-        if (m_recv_buf->capacity() > SocketBuffer::BUFFER_MAX_READ &&
+        /* recovery socket buffer, chain buffer recycles segments itself. */
+        if (!m_recv_buf->is_chain() &&
+            m_recv_buf->capacity() > SocketBuffer::BUFFER_MAX_READ &&
             m_recv_buf->readable_len() < m_recv_buf->capacity() / 2) {
             m_recv_buf->compact(m_recv_buf->readable_len() * 2);
         }
@@ -99,30 +105,34 @@ Codec::STATUS Connection::conn_write() {
         return Codec::STATUS::ERR;
     }
 
-    int write_len;
-    SocketBuffer* sbuf;
+    int cnt = 0, write_len;
+    SocketBuffer* bufs[2];
 
-    sbuf = m_send_buf;
     if (is_connected()) {
         /* pls send waiting buffer firstly, when connected. */
-        if (m_wait_send_buf != nullptr && m_wait_send_buf->readable_len() > 0) {
-            sbuf = m_wait_send_buf;
+        if (m_wait_send_buf != nullptr && m_wait_send_buf->is_readable()) {
+            bufs[cnt++] = m_wait_send_buf;
         }
     }
 
-    if (sbuf == nullptr || !sbuf->is_readable()) {
+    if (m_send_buf != nullptr && m_send_buf->is_readable()) {
+        bufs[cnt++] = m_send_buf;
+    }
+
+    if (cnt == 0) {
         LOG_TRACE("no data to send! fd: %d, seq: %llu", fd(), id());
         return Codec::STATUS::OK;
     }
 
-    write_len = sbuf->write_fd(fd(), m_errno);
+    /* flush all pending buffers (and their segments) by one syscall. */
+    write_len = SocketBuffer::write_fd(fd(), bufs, cnt, m_errno);
     if (write_len < 0) {
         if (m_errno == EAGAIN) {
             m_active_time = now();
             return Codec::STATUS::PAUSE;
         } else {
             LOG_ERROR("send data failed! fd: %d, seq: %llu, readable len: %d",
-                      fd(), id(), sbuf->readable_len());
+                      fd(), id(), bufs[0]->readable_len());
             return Codec::STATUS::ERR;
         }
     }
@@ -130,17 +140,23 @@ Codec::STATUS Connection::conn_write() {
     m_write_cnt++;
     m_write_bytes += write_len;
 
-    LOG_TRACE("send to fd: %d, conn id: %llu, write len: %d, readed data len: %d",
-              fd(), id(), write_len, sbuf->readable_len());
+    size_t left = 0;
+    for (int i = 0; i < cnt; i++) {
+        left += bufs[i]->readable_len();
 
-    /* recovery socket buffer. */
-    if (sbuf->capacity() > SocketBuffer::BUFFER_MAX_READ &&
-        sbuf->readable_len() < sbuf->capacity() / 2) {
-        sbuf->compact(sbuf->readable_len() * 2);
+        /* recovery socket buffer. */
+        SocketBuffer* sbuf = bufs[i];
+        if (!sbuf->is_chain() && sbuf->capacity() > SocketBuffer::BUFFER_MAX_READ &&
+            sbuf->readable_len() < sbuf->capacity() / 2) {
+            sbuf->compact(sbuf->readable_len() * 2);
+        }
     }
 
+    LOG_TRACE("send to fd: %d, conn id: %llu, write len: %d, readed data len: %d",
+              fd(), id(), write_len, left);
+
     m_active_time = now();
-    return (sbuf->readable_len() > 0) ? Codec::STATUS::PAUSE : Codec::STATUS::OK;
+    return (left > 0) ? Codec::STATUS::PAUSE : Codec::STATUS::OK;
 }
 
 Codec::STATUS Connection::conn_read(MsgHead& head, MsgBody& body) {
@@ -188,7 +204,7 @@ Codec::STATUS Connection::conn_write(
         return Codec::STATUS::ERR;
     }
 
-    if ((CHECK_NEW(*buf, SocketBuffer)) == nullptr) {
+    if ((CHECK_NEW(*buf, SocketBuffer(m_segment_pool))) == nullptr) {
         LOG_ERROR("alloc send buf failed!");
         return Codec::STATUS::ERR;
     }
@@ -225,14 +241,92 @@ Codec::STATUS Connection::decode_http(HttpMsg& msg) {
     if (codec == nullptr) {
         return Codec::STATUS::ERR;
     }
-    return codec->decode(m_recv_buf, msg);
+
+    if (is_pipeline_full()) {
+        /* keep the requests in buffer, until the responses are sent. */
+        LOG_TRACE("pipeline is full! fd: %d, cnt: %d", fd(), pipeline_cnt());
+        return Codec::STATUS::PAUSE;
+    }
+
+    Codec::STATUS ret = codec->decode(m_recv_buf, msg);
+    if (ret == Codec::STATUS::OK && msg.type() == HTTP_REQUEST) {
+        msg.set_seq(++m_http_req_seq);
+    }
+    return ret;
 }
 
 Codec::STATUS Connection::conn_write(const HttpMsg& msg) {
+    if (msg.type() == HTTP_RESPONSE && m_http_req_seq != 0) {
+        if (msg.seq() != 0) {
+            return pipeline_write(msg, msg.seq());
+        }
+        /* response without seq is sent while its request is processed. */
+        if (m_http_cur_seq != 0) {
+            return pipeline_write(msg, m_http_cur_seq);
+        }
+        /* or it can only answer the only request in processing. */
+        if (pipeline_cnt() != 1) {
+            LOG_ERROR("response without seq is ambiguous! fd: %d, req seq: %u, rsp seq: %u",
+                      fd(), m_http_req_seq, m_http_rsp_seq);
+            return Codec::STATUS::ERR;
+        }
+        return pipeline_write(msg, m_http_rsp_seq + 1);
+    }
     return conn_write(msg, &m_send_buf);
 }
 
+Codec::STATUS Connection::pipeline_write(const HttpMsg& msg, uint32_t seq) {
+    if (seq <= m_http_rsp_seq) {
+        LOG_WARN("response has been sent! fd: %d, seq: %u, rsp seq: %u",
+                 fd(), seq, m_http_rsp_seq);
+        return (m_send_buf != nullptr && m_send_buf->is_readable())
+                   ? Codec::STATUS::PAUSE
+                   : Codec::STATUS::OK;
+    }
+
+    if (seq > m_http_req_seq || m_http_rsp_queue.find(seq) != m_http_rsp_queue.end()) {
+        LOG_WARN("invalid response seq: %u, fd: %d, req seq: %u, rsp seq: %u",
+                 seq, fd(), m_http_req_seq, m_http_rsp_seq);
+        return Codec::STATUS::ERR;
+    }
+
+    if (seq != m_http_rsp_seq + 1) {
+        /* the earlier responses have not been sent, wait. */
+        m_http_rsp_queue[seq] = new HttpMsg(msg);
+        LOG_TRACE("pipeline wait, fd: %d, seq: %u, rsp seq: %u",
+                  fd(), seq, m_http_rsp_seq);
+        return (m_send_buf != nullptr && m_send_buf->is_readable())
+                   ? Codec::STATUS::PAUSE
+                   : Codec::STATUS::OK;
+    }
+
+    Codec::STATUS status = encode_http(msg, &m_send_buf);
+    if (status != Codec::STATUS::OK) {
+        return status;
+    }
+    m_http_rsp_seq++;
+
+    /* send the waiting responses which are in order now. */
+    auto it = m_http_rsp_queue.begin();
+    while (it != m_http_rsp_queue.end() && it->first == m_http_rsp_seq + 1) {
+        status = encode_http(*it->second, &m_send_buf);
+        delete it->second;
+        it = m_http_rsp_queue.erase(it);
+        if (status != Codec::STATUS::OK) {
+            return status;
+        }
+        m_http_rsp_seq++;
+    }
+
+    return conn_write();
+}
+
 Codec::STATUS Connection::conn_write(const HttpMsg& msg, SocketBuffer** buf) {
+    Codec::STATUS status = encode_http(msg, buf);
+    return (status != Codec::STATUS::OK) ? status : conn_write();
+}
+
+Codec::STATUS Connection::encode_http(const HttpMsg& msg, SocketBuffer** buf) {
     if (is_invalid()) {
         LOG_ERROR("conn is closed! fd: %d, seq: %llu", fd(), id());
         return Codec::STATUS::ERR;
@@ -243,7 +337,7 @@ Codec::STATUS Connection::conn_write(const HttpMsg& msg, SocketBuffer** buf) {
         return Codec::STATUS::ERR;
     }
 
-    if ((CHECK_NEW(*buf, SocketBuffer)) == nullptr) {
+    if ((CHECK_NEW(*buf, SocketBuffer(m_segment_pool))) == nullptr) {
         LOG_ERROR("alloc send buf failed!");
         return Codec::STATUS::ERR;
     }
@@ -252,10 +346,8 @@ Codec::STATUS Connection::conn_write(const HttpMsg& msg, SocketBuffer** buf) {
     if (status != Codec::STATUS::OK) {
         LOG_DEBUG("encode http packed failed! fd: %d, seq: %llu, status: %d",
                   fd(), id(), (int)status);
-        return status;
     }
-
-    return conn_write();
+    return status;
 }
 
 bool Connection::is_need_alive_check() {
@@ -293,7 +385,7 @@ struct sockaddr* Connection::sockaddr() {
 }
 
 double Connection::now() {
-    return (m_events != nullptr) ? m_events->now() : time_now();
+    return Clock::now();
 }
 
 }  // namespace kim
\ No newline at end of file
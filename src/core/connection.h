@@ -4,10 +4,12 @@
 #include <ev.h>
 
 #include <iostream>
+#include <map>
 
 #include "codec/codec_http.h"
 #include "codec/codec_proto.h"
 #include "events.h"
+#include "net/shm_ring.h"
 #include "protobuf/proto/http.pb.h"
 #include "timer.h"
 #include "util/log.h"
@@ -43,7 +45,8 @@ class Connection : public Timer, Logger {
     void set_fd_data(int fd, uint64_t id) { m_fd_data = {fd, id}; }
 
     double now();
-    void set_events(Events* e) { m_events = e; }
+    /* buffers use chain mode, when the pool is set. */
+    void set_segment_pool(SegmentPool* pool) { m_segment_pool = pool; }
 
     void set_privdata(void* data) { m_privdata = data; }
     void* privdata() const { return m_privdata; }
@@ -72,11 +75,29 @@ class Connection : public Timer, Logger {
     void set_system(bool is_sys) { m_is_system = is_sys; }
     bool is_system() { return m_is_system; }
 
+    /* ctrl chanel's messages go through shared memory ring, if it is set. */
+    void set_shm_ring(ShmRing* ring) { m_shm_ring = ring; }
+    ShmRing* shm_ring() { return m_shm_ring; }
+
     Codec::STATUS conn_read(HttpMsg& msg);
     Codec::STATUS conn_write(const HttpMsg& msg);
     Codec::STATUS conn_write_waiting(HttpMsg& msg);
     Codec::STATUS fetch_data(HttpMsg& msg);
 
+    /* http pipelining, responses are sent in requests' order. */
+    void set_pipeline_depth(int depth) { m_pipeline_depth = depth; }
+    int pipeline_depth() { return m_pipeline_depth; }
+    int pipeline_cnt() { return (int)(m_http_req_seq - m_http_rsp_seq); }
+    bool is_pipeline_full() { return m_pipeline_depth > 0 && pipeline_cnt() >= m_pipeline_depth; }
+    void set_pipeline_paused(bool paused) { m_is_pipeline_paused = paused; }
+    bool is_pipeline_paused() { return m_is_pipeline_paused; }
+    /* the request in processing, its seq is given to the response without seq. */
+    void set_http_cur_seq(uint32_t seq) { m_http_cur_seq = seq; }
+    /* response of the pipelined request has been sent or queued. */
+    bool is_responded(uint32_t seq) {
+        return seq <= m_http_rsp_seq || m_http_rsp_queue.find(seq) != m_http_rsp_queue.end();
+    }
+
     Codec::STATUS conn_read(MsgHead& head, MsgBody& body);
     Codec::STATUS fetch_data(MsgHead& head, MsgBody& body);
     Codec::STATUS conn_write(const MsgHead& head, const MsgBody& body);
@@ -97,6 +118,8 @@ class Connection : public Timer, Logger {
     Codec::STATUS decode_http(HttpMsg& msg);
     Codec::STATUS decode_proto(MsgHead& head, MsgBody& body);
     Codec::STATUS conn_write(const HttpMsg& msg, SocketBuffer** buf);
+    Codec::STATUS encode_http(const HttpMsg& msg, SocketBuffer** buf);
+    Codec::STATUS pipeline_write(const HttpMsg& msg, uint32_t seq);
     Codec::STATUS conn_write(const MsgHead& head, const MsgBody& body, SocketBuffer** buf, bool is_send = true);
 
    private:
@@ -104,8 +127,8 @@ class Connection : public Timer, Logger {
     void* m_privdata = nullptr; /* private data. */
     ev_io* m_ev_io = nullptr;   /* libev io event. */
     Codec* m_codec = nullptr;   /* protocol parser。 */
-    Events* m_events = nullptr; /* events ptr for getting libev's time now(). */
     bool m_is_system = false;   /* system connection. */
+    ShmRing* m_shm_ring = nullptr; /* ring to send, owned by network. */
 
     int m_errno = 0;               /* error number. */
     STATE m_state = STATE::UNKOWN; /* connection status. */
@@ -113,11 +136,20 @@ class Connection : public Timer, Logger {
     SocketBuffer* m_recv_buf = nullptr;
     SocketBuffer* m_send_buf = nullptr;
     SocketBuffer* m_wait_send_buf = nullptr;
+    SegmentPool* m_segment_pool = nullptr; /* buffer segments pool. */
 
     size_t m_saddr_len = 0;
     struct sockaddr* m_saddr = nullptr;
     std::string m_node_id; /* for nodes contact. */
 
+    /* http pipelining. */
+    int m_pipeline_depth = 0;                       /* max requests in processing, 0: no limit. */
+    bool m_is_pipeline_paused = false;              /* stop decoding, when pipeline is full. */
+    uint32_t m_http_req_seq = 0;                    /* last request's sequence. */
+    uint32_t m_http_rsp_seq = 0;                    /* last sent response's sequence. */
+    uint32_t m_http_cur_seq = 0;                    /* request's sequence in processing. */
+    std::map<uint32_t, HttpMsg*> m_http_rsp_queue;  /* completed responses wait for the earlier ones. */
+
     /* statistics info. */
     int m_read_cnt = 0;
     uint64_t m_read_bytes = 0;
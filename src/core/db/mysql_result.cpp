@@ -36,6 +36,12 @@ int MysqlResult::result_data(vec_row_t &data) {
     return data.size();
 }
 
+void MysqlResult::rewind() {
+    if (m_res != nullptr) {
+        mysql_data_seek(m_res, 0);
+    }
+}
+
 MYSQL_ROW MysqlResult::fetch_row() {
     if (m_res == nullptr) {
         return nullptr;
@@ -26,6 +26,8 @@ class MysqlResult {
     unsigned int num_rows();
     const MYSQL_RES *result() { return m_res; }
     int result_data(vec_row_t &data);
+    /* read rows from the first one again. */
+    void rewind();
     unsigned long *fetch_lengths();
     unsigned int fetch_num_fields();
 
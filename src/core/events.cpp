@@ -6,7 +6,7 @@
 
 #include "connection.h"
 #include "module.h"
-#include "session.h"
+#include "util/clock.h"
 #include "util/util.h"
 
 namespace kim {
@@ -25,11 +25,44 @@ bool Events::create() {
         LOG_ERROR("new libev loop failed!");
         return false;
     }
+
+    /* runs before other callbacks, after polling. */
+    ev_check_init(&m_clock_watcher, &on_loop_check);
+    ev_set_priority(&m_clock_watcher, EV_MAXPRI);
+    ev_check_start(m_ev_loop, &m_clock_watcher);
+
+    m_wheel = new TimerWheel;
+    m_wheel->start(now());
+    m_wheel_timer = add_timer_event(m_wheel->tick(), m_wheel_timer, &on_wheel_tick, this);
+    if (m_wheel_timer == nullptr) {
+        LOG_ERROR("add timing wheel's timer failed!");
+        return false;
+    }
+    /* repeat_secs of add_timer_event is integer. */
+    m_wheel_timer->repeat = m_wheel->tick();
     return true;
 }
 
+void Events::on_wheel_tick(struct ev_loop* loop, ev_timer* w, int revents) {
+    Events* e = static_cast<Events*>(w->data);
+    e->m_wheel->run(e->now());
+}
+
+void Events::on_loop_check(struct ev_loop* loop, ev_check* w, int revents) {
+    Clock::update();
+}
+
 void Events::destory() {
+    Clock::set_cached(false);
+
+    if (m_wheel_timer != nullptr) {
+        del_timer_event(m_wheel_timer);
+        m_wheel_timer = nullptr;
+    }
+    SAFE_DELETE(m_wheel);
+
     if (m_ev_loop != nullptr) {
+        ev_check_stop(m_ev_loop, &m_clock_watcher);
         ev_loop_destroy(m_ev_loop);
         m_ev_loop = nullptr;
     }
@@ -37,7 +70,9 @@ void Events::destory() {
 
 void Events::run() {
     if (m_ev_loop != nullptr) {
+        Clock::set_cached(true);
         ev_run(m_ev_loop, 0);
+        Clock::set_cached(false);
     }
 }
 
@@ -48,7 +83,7 @@ void Events::end_ev_loop() {
 }
 
 double Events::now() {
-    return ev_now(m_ev_loop);
+    return Clock::now();
 }
 
 bool Events::create_signal_event(int signum, void* privdata) {
@@ -155,20 +190,22 @@ bool Events::del_write_event(ev_io* w) {
     return true;
 }
 
-ev_timer* Events::add_io_timer(double secs, ev_timer* w, void* privdata) {
-    if (m_io_timer_callback_fn == nullptr) {
-        LOG_ERROR("pls set io timer callback fn!");
-        return nullptr;
+bool Events::del_read_event(ev_io* w) {
+    if (w == nullptr) {
+        return false;
     }
-    return add_timer_event(secs, w, m_io_timer_callback_fn, privdata);
-}
 
-ev_timer* Events::add_cmd_timer(double secs, ev_timer* w, void* privdata) {
-    if (m_cmd_timer_callback_fn == nullptr) {
-        LOG_ERROR("pls set cmd timer callback fn!");
-        return nullptr;
+    if (w->events & EV_READ) {
+        int events = w->events & EV_WRITE;
+        ev_io_stop(m_ev_loop, w);
+        ev_io_set(w, w->fd, events);
+        if (events != 0) {
+            ev_io_start(m_ev_loop, w);
+        }
+        LOG_TRACE("del read event, fd: %d", w->fd);
     }
-    return add_timer_event(secs, w, m_cmd_timer_callback_fn, privdata, secs);
+
+    return true;
 }
 
 ev_timer* Events::add_repeat_timer(double secs, ev_timer* w, void* privdata) {
@@ -179,14 +216,6 @@ ev_timer* Events::add_repeat_timer(double secs, ev_timer* w, void* privdata) {
     return add_timer_event(secs, w, m_repeat_timer_callback_fn, privdata, secs);
 }
 
-ev_timer* Events::add_session_timer(double secs, ev_timer* w, void* privdata) {
-    if (m_session_timer_callback_fn == nullptr) {
-        LOG_ERROR("pls set session timer callback fn!");
-        return nullptr;
-    }
-    return add_timer_event(secs, w, m_session_timer_callback_fn, privdata, secs);
-}
-
 ev_timer* Events::add_timer_event(double secs, ev_timer* w, cb_timer tcb, void* privdata, int repeat_secs) {
     if (w == nullptr) {
         w = (ev_timer*)malloc(sizeof(ev_timer));
@@ -211,14 +240,51 @@ ev_timer* Events::add_timer_event(double secs, ev_timer* w, cb_timer tcb, void*
     return w;
 }
 
-bool Events::restart_timer(double secs, ev_timer* w, void* privdata) {
+wheel_timer_t* Events::add_io_timer(double secs, wheel_timer_t* w, void* privdata) {
+    if (m_io_timer_callback_fn == nullptr) {
+        LOG_ERROR("pls set io timer callback fn!");
+        return nullptr;
+    }
+    return add_wheel_timer(secs, w, m_io_timer_callback_fn, privdata);
+}
+
+wheel_timer_t* Events::add_cmd_timer(double secs, wheel_timer_t* w, void* privdata) {
+    if (m_cmd_timer_callback_fn == nullptr) {
+        LOG_ERROR("pls set cmd timer callback fn!");
+        return nullptr;
+    }
+    return add_wheel_timer(secs, w, m_cmd_timer_callback_fn, privdata);
+}
+
+wheel_timer_t* Events::add_wheel_timer(double secs, wheel_timer_t* w, cb_wheel_timer tcb, void* privdata) {
+    if (m_wheel == nullptr) {
+        LOG_ERROR("pls create events firstly!");
+        return nullptr;
+    }
+
     if (w == nullptr) {
+        w = (wheel_timer_t*)malloc(sizeof(wheel_timer_t));
+        if (w == nullptr) {
+            LOG_ERROR("alloc timer failed!");
+            return nullptr;
+        }
+        memset(w, 0, sizeof(wheel_timer_t));
+    }
+
+    w->cb = tcb;
+    w->data = privdata;
+    m_wheel->add(w, now(), secs);
+
+    LOG_TRACE("start timer, timer: %p, seconds: %f", w, secs);
+    return w;
+}
+
+bool Events::restart_timer(double secs, wheel_timer_t* w, void* privdata) {
+    if (w == nullptr || m_wheel == nullptr) {
         return false;
     }
-    ev_timer_stop(m_ev_loop, w);
-    ev_timer_set(w, secs + ev_time() - ev_now(m_ev_loop), 0);
-    ev_timer_start(m_ev_loop, w);
     w->data = privdata;
+    m_wheel->add(w, now(), secs);
     LOG_TRACE("restart timer, seconds: %f", secs);
     return true;
 }
@@ -249,6 +315,21 @@ bool Events::del_timer_event(ev_timer* w) {
     return true;
 }
 
+bool Events::del_timer_event(wheel_timer_t* w) {
+    if (w == nullptr) {
+        return false;
+    }
+
+    LOG_TRACE("delete timer event: %p", w);
+
+    if (m_wheel != nullptr) {
+        m_wheel->del(w);
+    }
+    w->data = nullptr;
+    SAFE_FREE(w);
+    return true;
+}
+
 bool Events::stop_io_event(ev_io* w) {
     if (w == nullptr) {
         return false;
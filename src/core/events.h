@@ -5,6 +5,7 @@
 #include <hiredis/async.h>
 
 #include "server.h"
+#include "timer_wheel.h"
 #include "util/log.h"
 
 namespace kim {
@@ -34,6 +35,7 @@ class Events : public Logger {
     ev_io* add_read_event(int fd, ev_io* w, void* privdata);
     ev_io* add_write_event(int fd, ev_io* w, void* privdata);
     bool del_write_event(ev_io* w);
+    bool del_read_event(ev_io* w);
     bool del_io_event(ev_io* w);
     bool stop_io_event(ev_io* w);
 
@@ -42,35 +44,41 @@ class Events : public Logger {
     bool create_signal_event(int signum, void* privdata);
 
     /* timer */
-    ev_timer* add_io_timer(double secs, ev_timer* w, void* privdata);
     ev_timer* add_repeat_timer(double secs, ev_timer* w, void* privdata);
-    ev_timer* add_cmd_timer(double secs, ev_timer* w, void* privdata);
-    ev_timer* add_session_timer(double secs, ev_timer* w, void* privdata);
     ev_timer* add_timer_event(double secs, ev_timer* w, cb_timer tcb, void* privdata, int repeat_secs = 0);
-    bool restart_timer(double secs, ev_timer* w, void* privdata);
     bool del_timer_event(ev_timer* w);
 
+    /* timeout of connection and cmd, they are in timing wheel. */
+    wheel_timer_t* add_io_timer(double secs, wheel_timer_t* w, void* privdata);
+    wheel_timer_t* add_cmd_timer(double secs, wheel_timer_t* w, void* privdata);
+    wheel_timer_t* add_wheel_timer(double secs, wheel_timer_t* w, cb_wheel_timer tcb, void* privdata);
+    bool restart_timer(double secs, wheel_timer_t* w, void* privdata);
+    bool del_timer_event(wheel_timer_t* w);
+
     /* set callback fn. */
     void set_io_callback_fn(cb_io fn) { m_io_callback_fn = fn; }
     void set_sig_callback_fn(cb_sig fn) { m_sig_callback_fn = fn; }
-    void set_io_timer_callback_fn(cb_timer fn) { m_io_timer_callback_fn = fn; }
-    void set_cmd_timer_callback_fn(cb_timer fn) { m_cmd_timer_callback_fn = fn; }
+    void set_io_timer_callback_fn(cb_wheel_timer fn) { m_io_timer_callback_fn = fn; }
+    void set_cmd_timer_callback_fn(cb_wheel_timer fn) { m_cmd_timer_callback_fn = fn; }
     void set_repeat_timer_callback_fn(cb_timer fn) { m_repeat_timer_callback_fn = fn; }
-    void set_session_timer_callback_fn(cb_timer fn) { m_session_timer_callback_fn = fn; }
 
    private:
     void destory();
+    static void on_wheel_tick(struct ev_loop* loop, ev_timer* w, int revents);
+    static void on_loop_check(struct ev_loop* loop, ev_check* w, int revents);
 
    private:
     struct ev_loop* m_ev_loop = nullptr;
+    TimerWheel* m_wheel = nullptr;      /* timing wheel. */
+    ev_timer* m_wheel_timer = nullptr; /* drives the wheel every tick. */
+    ev_check m_clock_watcher;          /* updates clock once per loop iteration. */
 
     /* callback fn. */
     cb_io m_io_callback_fn = nullptr;
     cb_sig m_sig_callback_fn = nullptr;
-    cb_timer m_io_timer_callback_fn = nullptr;
-    cb_timer m_cmd_timer_callback_fn = nullptr;
+    cb_wheel_timer m_io_timer_callback_fn = nullptr;
+    cb_wheel_timer m_cmd_timer_callback_fn = nullptr;
     cb_timer m_repeat_timer_callback_fn = nullptr;
-    cb_timer m_session_timer_callback_fn = nullptr;
 };
 
 }  // namespace kim
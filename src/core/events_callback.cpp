@@ -3,7 +3,6 @@
 #include "cmd.h"
 #include "connection.h"
 #include "events.h"
-#include "session.h"
 
 namespace kim {
 
@@ -79,14 +78,6 @@ bool EventsCallback::setup_cmd_timer_callback() {
     return false;
 }
 
-bool EventsCallback::setup_session_timer_callback() {
-    if (m_network != nullptr) {
-        m_network->events()->set_session_timer_callback_fn(&on_session_timer_callback);
-        return true;
-    }
-    return false;
-}
-
 void EventsCallback::on_repeat_timer_callback(struct ev_loop* loop, ev_timer* w, int revents) {
     EventsCallback* e = static_cast<EventsCallback*>(w->data);
     e->on_repeat_timer(w->data);
@@ -103,22 +94,16 @@ void EventsCallback::on_io_callback(struct ev_loop* loop, ev_io* w, int events)
     if (events & EV_WRITE) e->on_io_write(w->fd);
 }
 
-void EventsCallback::on_io_timer_callback(struct ev_loop* loop, ev_timer* w, int revents) {
+void EventsCallback::on_io_timer_callback(wheel_timer_t* w) {
     Connection* c = static_cast<Connection*>(w->data);
     EventsCallback* e = static_cast<EventsCallback*>(c->privdata());
     e->on_io_timer(w->data);
 }
 
-void EventsCallback::on_cmd_timer_callback(struct ev_loop* loop, ev_timer* w, int revents) {
+void EventsCallback::on_cmd_timer_callback(wheel_timer_t* w) {
     Cmd* cmd = static_cast<Cmd*>(w->data);
     EventsCallback* e = (EventsCallback*)cmd->net();
     e->on_cmd_timer((void*)cmd);
 }
 
-void EventsCallback::on_session_timer_callback(struct ev_loop* loop, ev_timer* w, int revents) {
-    Session* s = static_cast<Session*>(w->data);
-    EventsCallback* e = (EventsCallback*)s->net();
-    e->on_session_timer(s);
-}
-
 }  // namespace kim
\ No newline at end of file
@@ -19,15 +19,13 @@ class EventsCallback {
     bool setup_io_callback();
     bool setup_io_timer_callback();
     bool setup_cmd_timer_callback();
-    bool setup_session_timer_callback();
 
    public:
     static void on_signal_callback(struct ev_loop* loop, ev_signal* s, int revents);
     static void on_repeat_timer_callback(struct ev_loop* loop, ev_timer* w, int revents);
     static void on_io_callback(struct ev_loop* loop, ev_io* w, int events);
-    static void on_io_timer_callback(struct ev_loop* loop, ev_timer* w, int revents);
-    static void on_cmd_timer_callback(struct ev_loop* loop, ev_timer* w, int revents);
-    static void on_session_timer_callback(struct ev_loop* loop, ev_timer* w, int revents);
+    static void on_io_timer_callback(wheel_timer_t* w);
+    static void on_cmd_timer_callback(wheel_timer_t* w);
 
     virtual void on_terminated(ev_signal* s) {}
     virtual void on_child_terminated(ev_signal* s) {}
@@ -36,7 +34,6 @@ class EventsCallback {
     virtual void on_repeat_timer(void* privdata) {}
     virtual void on_io_timer(void* privdata) {}
     virtual void on_cmd_timer(void* privdata) {}
-    virtual void on_session_timer(void* privdata) {}
 
    protected:
     Log* m_logger = nullptr;     /* logger. */
@@ -95,6 +95,32 @@ bool Manager::load_logger() {
 
     m_logger->set_worker_index(0);
     m_logger->set_process_type(true);
+
+    if (!m_logger->set_format(m_conf("log_format").c_str())) {
+        LOG_ERROR("invalid log_format: %s", m_conf("log_format").c_str());
+        return false;
+    }
+
+    bool is_async = false;
+    m_conf.Get("log_async", is_async);
+    if (is_async) {
+        int ring_cnt = Log::ASYNC_RING_CNT;
+        m_conf.Get("log_async_ring_cnt", ring_cnt);
+        if (!m_logger->set_full_policy(m_conf("log_full_policy").c_str())) {
+            LOG_ERROR("invalid log_full_policy: %s", m_conf("log_full_policy").c_str());
+            return false;
+        }
+
+        /* manager rotates the file, workers follow it. */
+        int rotate_size = 0, rotate_interval = 0;
+        m_conf.Get("log_rotate_size", rotate_size);
+        m_conf.Get("log_rotate_interval", rotate_interval);
+        m_logger->set_rotate((size_t)rotate_size * 1024 * 1024, rotate_interval);
+        if (!m_logger->set_async((size_t)ring_cnt)) {
+            LOG_ERROR("set async log failed! ring cnt: %d", ring_cnt);
+            return false;
+        }
+    }
     return true;
 }
 
@@ -221,6 +247,8 @@ void Manager::restart_workers() {
 
 bool Manager::create_worker(int worker_index) {
     int pid, data_fds[2], ctrl_fds[2];
+    /* shared memory rings, 0: manager -> worker, 1: worker -> manager. */
+    ShmRing* rings[2] = {nullptr, nullptr};
 
     if (socketpair(PF_UNIX, SOCK_STREAM, 0, ctrl_fds) < 0) {
         LOG_ERROR("create socket pair failed! %d: %s", errno, strerror(errno));
@@ -233,6 +261,11 @@ bool Manager::create_worker(int worker_index) {
         return false;
     }
 
+    if (m_net->is_shm_chanel() && !create_shm_rings(rings)) {
+        LOG_WARN("create shm rings failed, ctrl chanel uses socket! index: %d",
+                 worker_index);
+    }
+
     if ((pid = fork()) == 0) {
         /* child. */
         m_net->end_ev_loop();
@@ -243,6 +276,8 @@ bool Manager::create_worker(int worker_index) {
         close(data_fds[0]);
 
         worker_info_t info{0, worker_index, ctrl_fds[1], data_fds[1], m_node_info.work_path()};
+        info.send_ring = rings[1];
+        info.recv_ring = rings[0];
         LOG_INFO("worker chanels, fd1: %d, fd2: %d", info.ctrl_fd, info.data_fd);
 
         Worker worker(worker_name(worker_index));
@@ -263,9 +298,18 @@ bool Manager::create_worker(int worker_index) {
             m_net->close_conn(data_fds[0]);
             LOG_CRIT("chanel fd add event failed! kill child: %d", pid);
             kill(pid, SIGKILL);
+            SAFE_DELETE(rings[0]);
+            SAFE_DELETE(rings[1]);
             return false;
         }
 
+        if (rings[0] != nullptr && !m_net->add_shm_chanel(ctrl_fds[0], rings[0], rings[1])) {
+            LOG_WARN("add shm chanel failed, ctrl chanel uses socket! index: %d",
+                     worker_index);
+            SAFE_DELETE(rings[0]);
+            SAFE_DELETE(rings[1]);
+        }
+
         m_net->worker_data_mgr()->add_worker_info(
             worker_index, pid, ctrl_fds[0], data_fds[0]);
         LOG_INFO("manager ctrl_fd: %d, data_fd: %d", ctrl_fds[0], data_fds[0]);
@@ -274,12 +318,27 @@ bool Manager::create_worker(int worker_index) {
     } else {
         m_net->close_chanel(data_fds);
         m_net->close_chanel(ctrl_fds);
+        SAFE_DELETE(rings[0]);
+        SAFE_DELETE(rings[1]);
         LOG_ERROR("error: %d, %s", errno, strerror(errno));
     }
 
     return false;
 }
 
+bool Manager::create_shm_rings(ShmRing** rings) {
+    for (int i = 0; i < 2; i++) {
+        rings[i] = new ShmRing;
+        if (!rings[i]->init()) {
+            LOG_ERROR("init shm ring failed! %d: %s", errno, strerror(errno));
+            SAFE_DELETE(rings[0]);
+            SAFE_DELETE(rings[1]);
+            return false;
+        }
+    }
+    return true;
+}
+
 void Manager::create_workers() {
     for (int i = 1; i <= m_node_info.worker_cnt(); i++) {
         if (!create_worker(i)) {
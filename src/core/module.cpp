@@ -10,6 +10,21 @@ Module::Module(Log* logger, INet* net, uint64_t id, const std::string& name)
 }
 
 Module::~Module() {
+    for (const auto& it : m_cmd_pools) {
+        it.second->close();
+    }
+    m_cmd_pools.clear();
+}
+
+CmdPool* Module::get_cmd_pool(const char* name) {
+    auto it = m_cmd_pools.find(name);
+    if (it != m_cmd_pools.end()) {
+        return it->second;
+    }
+
+    CmdPool* pool = new CmdPool(name);
+    m_cmd_pools[name] = pool;
+    return pool;
 }
 
 bool Module::init(Log* logger, INet* net, uint64_t id, const std::string& name) {
@@ -22,18 +37,24 @@ bool Module::init(Log* logger, INet* net, uint64_t id, const std::string& name)
 }
 
 Cmd::STATUS Module::execute_cmd(Cmd* cmd, const Request& req) {
-    ev_timer* w;
+    wheel_timer_t* w;
     Cmd::STATUS ret;
 
+    cmd->set_module(this);
+    add_cmd_ref();
+
     ret = cmd->execute(req);
     if (ret != Cmd::STATUS::RUNNING) {
-        SAFE_DELETE(cmd);
+        Cmd::release(cmd);
         return ret;
     }
 
+    /* cmd is async, the request's arena moves to it. */
+    cmd->hold_req();
+
     if (!net()->add_cmd(cmd)) {
         LOG_ERROR("add cmd duplicate, id: %llu!", cmd->id());
-        SAFE_DELETE(cmd);
+        Cmd::release(cmd);
         return Cmd::STATUS::ERROR;
     }
 
@@ -62,4 +83,25 @@ Cmd::STATUS Module::response_http(const fd_t& f, const std::string& data, int st
     return Cmd::STATUS::OK;
 }
 
+Cmd::STATUS Module::response_http(const Request& req, const std::string& data, int status_code) {
+    const HttpMsg* req_msg = req.http_msg();
+    if (req_msg == nullptr) {
+        LOG_ERROR("http msg is null!");
+        return Cmd::STATUS::ERROR;
+    }
+
+    HttpMsg msg;
+    msg.set_type(HTTP_RESPONSE);
+    msg.set_status_code(status_code);
+    msg.set_http_major(req_msg->http_major());
+    msg.set_http_minor(req_msg->http_minor());
+    msg.set_seq(req_msg->seq());
+    msg.set_body(data);
+
+    if (!net()->send_to(req.fd_data(), msg)) {
+        return Cmd::STATUS::ERROR;
+    }
+    return Cmd::STATUS::OK;
+}
+
 }  // namespace kim
\ No newline at end of file
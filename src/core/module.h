@@ -21,7 +21,44 @@ class Module : public Base, public So {
     bool init(Log* logger, INet* net, uint64_t id, const std::string& name = "");
     virtual Cmd::STATUS process_req(const Request& req) { return Cmd::STATUS::UNKOWN; }
     Cmd::STATUS execute_cmd(Cmd* cmd, const Request& req);
+    /* without request, it answers the request in processing (in process_req),
+     * or the only request of connection, pipelined requests need the other one. */
     Cmd::STATUS response_http(const fd_t& f, const std::string& data, int status_code = 200);
+    /* response in request's order, for http pipelining. */
+    Cmd::STATUS response_http(const Request& req, const std::string& data, int status_code = 200);
+
+    /* pooled cmd, name is a string literal, its address is the pool's key. */
+    template <typename T>
+    T* alloc_cmd(const char* name) {
+        CmdPool* pool = get_cmd_pool(name);
+        T* cmd = static_cast<T*>(pool->get());
+        if (cmd == nullptr) {
+            cmd = new T(m_logger, m_net, m_net->new_seq(), name);
+            cmd->set_pool(pool);
+            pool->add_used();
+        } else {
+            cmd->set_id(m_net->new_seq());
+            cmd->set_active_time(m_net->now());
+        }
+        return cmd;
+    }
+    CmdPool* get_cmd_pool(const char* name);
+    const std::unordered_map<const char*, CmdPool*>& cmd_pools() const { return m_cmd_pools; }
+
+    /* hot reload, the retired module is closed when its cmds are done. */
+    void add_cmd_ref() { m_cmd_cnt++; }
+    void del_cmd_ref() { m_cmd_cnt--; }
+    size_t cmd_cnt() const { return m_cmd_cnt; }
+    void set_generation(uint32_t gen) { m_generation = gen; }
+    uint32_t generation() const { return m_generation; }
+    void set_retired(bool retired) { m_is_retired = retired; }
+    bool is_retired() const { return m_is_retired; }
+
+   protected:
+    std::unordered_map<const char*, CmdPool*> m_cmd_pools;
+    size_t m_cmd_cnt = 0;      /* cmds which are not released. */
+    uint32_t m_generation = 0; /* increased by each reload. */
+    bool m_is_retired = false;
 };
 
 #define REGISTER_HANDLER(class_name)                                              \
@@ -69,6 +106,19 @@ class Module : public Base, public So {
         return execute_cmd(p, req);                                   \
     } while (0);
 
+/* like HANDLE_CMD, but cmd objects are reused by a per type pool. */
+#define HANDLE_POOLED_CMD(_cmd)                           \
+    do {                                                  \
+        _cmd* p = alloc_cmd<_cmd>(#_cmd);                 \
+        p->set_req(req);                                  \
+        if (!p->init()) {                                 \
+            LOG_ERROR("init cmd failed! %s", p->name());  \
+            Cmd::release(p);                              \
+            return Cmd::STATUS::ERROR;                    \
+        }                                                 \
+        return execute_cmd(p, req);                       \
+    } while (0);
+
 }  // namespace kim
 
 #endif  //__KIM_MODULE_H__
\ No newline at end of file
@@ -1,6 +1,11 @@
 #include "module_mgr.h"
 
 #include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "session.h"
+#include "util/util.h"
 
 #define MODULE_DIR "/modules/"
 #define DL_ERROR() (dlerror() != nullptr) ? dlerror() : "unknown error"
@@ -14,22 +19,27 @@ ModuleMgr::ModuleMgr(uint64_t id, Log* logger, INet* net, const std::string& nam
 }
 
 ModuleMgr::~ModuleMgr() {
-    Module* module;
     for (const auto& it : m_modules) {
-        module = it.second;
-        if (dlclose(module->so_handle()) == -1) {
-            LOG_ERROR("close so failed! so: %s, errstr: %s",
-                      module->name(), DL_ERROR());
-        }
-        SAFE_DELETE(module);
+        close_so(it.second);
     }
     m_modules.clear();
+
+    for (auto module : m_retired_modules) {
+        if (module->cmd_cnt() > 0) {
+            LOG_WARN("close so with running cmds! so: %s, cmds: %lu",
+                     module->name(), module->cmd_cnt());
+        }
+        close_so(module);
+    }
+    m_retired_modules.clear();
 }
 
 bool ModuleMgr::init(CJsonObject& config) {
     std::string name, path;
     CJsonObject& array = config["modules"];
 
+    config.Get("module_hot_reload", m_is_hot_reload);
+
     for (int i = 0; i < array.GetArraySize(); i++) {
         name = array(i);
         path = work_path() + MODULE_DIR + name;
@@ -49,56 +59,115 @@ bool ModuleMgr::init(CJsonObject& config) {
     return true;
 }
 
-bool ModuleMgr::load_so(const std::string& name, const std::string& path, uint64_t id) {
+Module* ModuleMgr::open_so(const std::string& name, const std::string& path, uint64_t id, uint32_t gen) {
     void* handle;
+    struct stat st;
     Module* module;
     CreateModule* create_module;
+    std::string open_path = path;
 
-    module = get_module(name);
-    if (module != nullptr) {
-        LOG_ERROR("duplicate load so: %s", name.c_str());
-        return false;
+    if (stat(path.c_str(), &st) == -1) {
+        LOG_ERROR("stat so failed! so: %s, errno: %d", path.c_str(), errno);
+        return nullptr;
+    }
+
+    /* dlopen returns the loaded handle for the same path,
+     * so the new generation is opened through a temporary hard link. */
+    if (gen > 0) {
+        open_path = format_str("%s.%u", path.c_str(), gen);
+        unlink(open_path.c_str());
+        if (link(path.c_str(), open_path.c_str()) == -1) {
+            LOG_ERROR("link so failed! so: %s, errno: %d", open_path.c_str(), errno);
+            return nullptr;
+        }
     }
 
     /* load so. */
-    handle = dlopen(path.c_str(), RTLD_NOW);
+    handle = dlopen(open_path.c_str(), RTLD_NOW);
+    if (gen > 0) {
+        unlink(open_path.c_str());
+    }
     if (handle == nullptr) {
         LOG_ERROR("open so failed! so: %s, errstr: %s", path.c_str(), DL_ERROR());
-        return false;
+        return nullptr;
     }
 
     create_module = (CreateModule*)dlsym(handle, "create");
     if (create_module == nullptr) {
         LOG_ERROR("open so failed! so: %s, errstr: %s", path.c_str(), DL_ERROR());
         if (dlclose(handle) == -1) {
-            LOG_ERROR("close so failed! so: %s, errstr: %s",
-                      module->name(), DL_ERROR());
+            LOG_ERROR("close so failed! so: %s, errstr: %s", name.c_str(), DL_ERROR());
         }
-        return false;
+        return nullptr;
     }
 
     module = (Module*)create_module();
-    id = (id != 0) ? id : m_net->new_seq();
-    if (!module->init(m_logger, m_net, id, name)) {
+    if (module == nullptr || !module->init(m_logger, m_net, id, name)) {
         LOG_ERROR("init module failed! module: %s", name.c_str());
+        SAFE_DELETE(module);
         if (dlclose(handle) == -1) {
-            LOG_ERROR("close so failed! so: %s, errstr: %s",
-                      module->name(), DL_ERROR());
+            LOG_ERROR("close so failed! so: %s, errstr: %s", name.c_str(), DL_ERROR());
         }
-        return false;
+        return nullptr;
     }
 
     module->set_name(name);
     module->set_so_path(path);
     module->set_so_handle(handle);
+    module->set_so_mtime(st.st_mtime);
+    module->set_generation(gen);
+    return module;
+}
+
+void ModuleMgr::close_so(Module* module) {
+    Dl_info info;
+    size_t cnt = 0;
+    void* base = nullptr;
+    void* handle = module->so_handle();
+    std::string name = module->name();
+    uint32_t gen = module->generation();
+    SessionMgr* session_mgr = net()->session_mgr();
+
+    /* the sessions created by module, their code is in so too. */
+    if (dladdr(*(void**)module, &info) != 0) {
+        base = info.dli_fbase;
+    }
+    if (base != nullptr && session_mgr != nullptr) {
+        cnt = session_mgr->del_sessions_if([base](Session* s) {
+            Dl_info i;
+            return dladdr(*(void**)s, &i) != 0 && i.dli_fbase == base;
+        });
+    }
+
+    /* module's code is in so, delete it before closing so. */
+    SAFE_DELETE(module);
+    if (dlclose(handle) == -1) {
+        LOG_ERROR("close so failed! so: %s, errstr: %s", name.c_str(), DL_ERROR());
+    }
+
+    LOG_INFO("close so: %s, generation: %u, deleted sessions: %lu", name.c_str(), gen, cnt);
+}
+
+bool ModuleMgr::load_so(const std::string& name, const std::string& path, uint64_t id) {
+    Module* module = get_module(name);
+    if (module != nullptr) {
+        LOG_ERROR("duplicate load so: %s", name.c_str());
+        return false;
+    }
+
+    id = (id != 0) ? id : m_net->new_seq();
+    module = open_so(name, path, id, 0);
+    if (module == nullptr) {
+        return false;
+    }
+
     m_modules[id] = module;
     LOG_INFO("load so: %s done!", name.c_str());
     return true;
 }
 
 bool ModuleMgr::reload_so(const std::string& name) {
-    uint64_t id = 0;
-    Module* module = nullptr;
+    Module *module, *old;
     std::string path = work_path() + MODULE_DIR + name;
     LOG_DEBUG("reloading so: %s, path: %s!", name.c_str(), path.c_str());
 
@@ -107,13 +176,22 @@ bool ModuleMgr::reload_so(const std::string& name) {
         return false;
     }
 
-    module = get_module(name);
-    if (module != nullptr) {
-        id = module->id();
+    old = get_module(name);
+    if (old == nullptr) {
+        return load_so(name, path);
+    }
+
+    /* the old one keeps working if the new one fails. */
+    module = open_so(name, path, old->id(), old->generation() + 1);
+    if (module == nullptr) {
+        LOG_ERROR("reload so failed! so: %s", name.c_str());
+        return false;
     }
 
-    unload_so(name);
-    return load_so(name, path, id);
+    m_modules[old->id()] = module;
+    retire(old);
+    LOG_INFO("reload so: %s done! generation: %u", name.c_str(), module->generation());
+    return true;
 }
 
 bool ModuleMgr::unload_so(const std::string& name) {
@@ -123,21 +201,60 @@ bool ModuleMgr::unload_so(const std::string& name) {
         return false;
     }
 
-    if (dlclose(module->so_handle()) == -1) {
-        LOG_ERROR("close so failed! so: %s, errstr: %s",
-                  module->name(), DL_ERROR());
+    m_modules.erase(module->id());
+    retire(module);
+    LOG_INFO("unload module so: %s", name.c_str());
+    return true;
+}
+
+void ModuleMgr::retire(Module* module) {
+    module->set_retired(true);
+    m_retired_modules.push_back(module);
+    check_retired_modules();
+}
+
+void ModuleMgr::check_retired_modules() {
+    Module* module;
+    for (auto it = m_retired_modules.begin(); it != m_retired_modules.end();) {
+        module = *it;
+        if (module->cmd_cnt() > 0) {
+            it++;
+            continue;
+        }
+        it = m_retired_modules.erase(it);
+        close_so(module);
     }
+}
 
-    auto it = m_modules.find(module->id());
-    if (it != m_modules.end()) {
-        m_modules.erase(it);
-    } else {
-        LOG_ERROR("find module: %s failed!", name.c_str());
+void ModuleMgr::check_so_changes() {
+    struct stat st;
+    std::vector<std::string> names;
+
+    for (const auto& it : m_modules) {
+        Module* module = it.second;
+        if (stat(module->so_path(), &st) == -1 || st.st_mtime == module->so_mtime()) {
+            continue;
+        }
+        /* wait for the file to be written completely,
+         * st_mtime is wall clock time, net's now() is monotonic. */
+        if (Clock::wall_time() - st.st_mtime < 1) {
+            continue;
+        }
+        /* a broken so is not tried again until it changes. */
+        module->set_so_mtime(st.st_mtime);
+        names.push_back(module->name());
     }
-    SAFE_DELETE(module);
 
-    LOG_INFO("unload module so: %s", name.c_str());
-    return true;
+    for (const auto& name : names) {
+        reload_so(name);
+    }
+}
+
+void ModuleMgr::on_repeat_timer() {
+    if (m_is_hot_reload) {
+        check_so_changes();
+    }
+    check_retired_modules();
 }
 
 Module* ModuleMgr::get_module(uint64_t id) {
@@ -146,14 +263,32 @@ Module* ModuleMgr::get_module(uint64_t id) {
 }
 
 Module* ModuleMgr::get_module(const std::string& name) {
-    Module* module = nullptr;
     for (const auto& it : m_modules) {
-        module = it.second;
-        if (module->name() == name) {
-            break;
+        if (it.second->name() == name) {
+            return it.second;
+        }
+    }
+    return nullptr;
+}
+
+void ModuleMgr::get_cmd_pool_stats(Payload& payload) {
+    CmdPool* pool;
+    CmdPoolStats* stats;
+
+    for (const auto& it : m_modules) {
+        for (const auto& itr : it.second->cmd_pools()) {
+            pool = itr.second;
+            stats = payload.add_cmd_pools();
+            stats->set_name(pool->name());
+            stats->set_hit_cnt(pool->hit_cnt());
+            stats->set_miss_cnt(pool->miss_cnt());
+            stats->set_free_cnt(pool->free_cnt());
+            if (pool->hit_cnt() + pool->miss_cnt() > 0) {
+                stats->set_hit_rate((double)pool->hit_cnt() /
+                                    (pool->hit_cnt() + pool->miss_cnt()));
+            }
         }
     }
-    return module;
 }
 
 Cmd::STATUS ModuleMgr::process_req(const Request& req) {
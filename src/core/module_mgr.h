@@ -2,7 +2,10 @@
 #ifndef __KIM_MODULE_MGR_H__
 #define __KIM_MODULE_MGR_H__
 
+#include <list>
+
 #include "module.h"
+#include "protobuf/sys/payload.pb.h"
 #include "util/json/CJsonObject.hpp"
 
 namespace kim {
@@ -17,15 +20,30 @@ class ModuleMgr : Base {
 
     Cmd::STATUS process_req(const Request& req);
     Cmd::STATUS process_ack(Request& req);
+    /* new requests go to the new so, the old one is retired,
+     * and it is closed after its last cmd is released. */
     bool reload_so(const std::string& name);
+    /* modules' cmd pools stats. */
+    void get_cmd_pool_stats(Payload& payload);
+    /* check so files' changes and close the retired modules. */
+    void on_repeat_timer();
+    /* reloaded modules which wait for their cmds. */
+    size_t retired_cnt() const { return m_retired_modules.size(); }
 
    private:
     Module* get_module(const std::string& name);
+    Module* open_so(const std::string& name, const std::string& path, uint64_t id, uint32_t gen);
+    void close_so(Module* module);
     bool load_so(const std::string& name, const std::string& path, uint64_t id = 0);
     bool unload_so(const std::string& name);
+    void retire(Module* module);
+    void check_retired_modules();
+    void check_so_changes();
 
    private:
     std::unordered_map<uint64_t, Module*> m_modules;  // modules.
+    std::list<Module*> m_retired_modules;            // reloaded modules with running cmds.
+    bool m_is_hot_reload = false;                     // reload so when its file changes.
 };
 
 }  // namespace kim
@@ -7,6 +7,8 @@
 
 #include "connection.h"
 #include "db/mysql_async_conn.h"
+#include "util/clock.h"
+#include "util/flat_map.h"
 #include "util/json/CJsonObject.hpp"
 #include "zookeeper/zk_task.h"
 
@@ -15,6 +17,7 @@ namespace kim {
 class Cmd;
 class INet;
 class Session;
+class SessionMgr;
 class Events;
 class zk_node;
 class SysCmd;
@@ -35,7 +38,7 @@ class INet {
     virtual ~INet() {}
 
    public:
-    virtual double now() { return time_now(); }
+    virtual double now() { return Clock::now(); }
     virtual uint64_t new_seq() { return 0; }
     virtual CJsonObject& config() { return m_conf; }
     virtual Events* events() { return nullptr; }
@@ -64,8 +67,9 @@ class INet {
 
     /* session */
     virtual bool add_session(Session* s) { return false; }
-    virtual Session* get_session(const std::string& sessid, bool re_active = false) { return nullptr; }
-    virtual bool del_session(const std::string& sessid) { return false; }
+    virtual Session* get_session(const StrView& sessid, bool re_active = false) { return nullptr; }
+    virtual bool del_session(const StrView& sessid) { return false; }
+    virtual SessionMgr* session_mgr() { return nullptr; }
 
    public:
     /* socket. */
@@ -94,8 +98,8 @@ class INet {
     virtual bool db_query(const char* node, const char* sql, Cmd* cmd) { return false; }
 
     // events
-    virtual ev_timer* add_cmd_timer(double secs, ev_timer* w, void* privdata) { return nullptr; }
-    virtual bool del_cmd_timer(ev_timer*) { return false; }
+    virtual wheel_timer_t* add_cmd_timer(double secs, wheel_timer_t* w, void* privdata) { return nullptr; }
+    virtual bool del_cmd_timer(wheel_timer_t*) { return false; }
 
    public:
     /* redis callback */
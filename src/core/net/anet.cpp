@@ -79,6 +79,17 @@ static int anet_set_reuse_addr(char *err, int fd) {
     return ANET_OK;
 }
 
+static int anet_set_reuse_port(char *err, int fd) {
+    int yes = 1;
+    /* Make sure sockets of processes can bind the same port,
+     * and the kernel balances the connections between them. */
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) == -1) {
+        anet_set_error(err, "setsockopt SO_REUSEPORT: %s", strerror(errno));
+        return ANET_ERR;
+    }
+    return ANET_OK;
+}
+
 static int anet_v6_only(char *err, int s) {
     int yes = 1;
     if (setsockopt(s, IPPROTO_IPV6, IPV6_V6ONLY, &yes, sizeof(yes)) == -1) {
@@ -89,7 +100,7 @@ static int anet_v6_only(char *err, int s) {
     return ANET_OK;
 }
 
-int anet_tcp_server(char *err, const char *bindaddr, int port, int backlog) {
+int anet_tcp_server(char *err, const char *bindaddr, int port, int backlog, bool reuse_port) {
     int s = -1, rv;
     char _port[6]; /* strlen("65535") */
     struct addrinfo hints, *servinfo, *p;
@@ -111,6 +122,7 @@ int anet_tcp_server(char *err, const char *bindaddr, int port, int backlog) {
 
         if (p->ai_family == AF_INET6 && anet_v6_only(err, s) == ANET_ERR) goto error;
         if (anet_set_reuse_addr(err, s) == ANET_ERR) goto error;
+        if (reuse_port && anet_set_reuse_port(err, s) == ANET_ERR) goto error;
         if (anet_listen(err, s, p->ai_addr, p->ai_addrlen, backlog) == ANET_ERR)
             s = ANET_ERR;
         goto end;
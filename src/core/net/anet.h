@@ -16,7 +16,7 @@ namespace kim {
 #define ANET_ERR -1
 #define ANET_ERR_LEN 256
 
-int anet_tcp_server(char *err, const char *bindaddr, int port, int backlog);
+int anet_tcp_server(char *err, const char *bindaddr, int port, int backlog, bool reuse_port = false);
 
 int anet_block(char *err, int fd);
 int anet_no_block(char *err, int fd);
@@ -4,11 +4,15 @@
 
 #include <string.h>
 #include <sys/socket.h>
+#include <unistd.h>
 
 namespace kim {
 
-#define LOG_FORMAT(level, args...) \
-    logger->log_data(__FILE__, __LINE__, __FUNCTION__, level, ##args);
+#define LOG_FORMAT(level, args...)                                                     \
+    if ((level) <= LOG_COMPILE_LEVEL && logger->is_level_enabled(level)) {                 \
+        static std::atomic<uint64_t> __log_site{0};                                        \
+        logger->log_data(&__log_site, __FILE__, __LINE__, __FUNCTION__, level, ##args);    \
+    }
 #define LOG_ERROR(args...) LOG_FORMAT((Log::LL_ERR), ##args)
 #define LOG_DEBUG(args...) LOG_FORMAT((Log::LL_DEBUG), ##args)
 #define LOG_TRACE(args...) LOG_FORMAT((Log::LL_TRACE), ##args)
@@ -153,4 +157,146 @@ int read_channel(int fd, channel_t* ch, size_t size, Log* logger) {
     return 0;
 }
 
+int write_channels(int fd, channel_t* chs, int cnt, Log* logger) {
+    LOG_TRACE("write to channel, fd: %d, batch cnt: %d", fd, cnt);
+    ssize_t n;
+    struct iovec iov[1];
+    struct msghdr msg;
+    int err = 0;
+
+    union {
+        struct cmsghdr cm;
+        char space[CMSG_SPACE(sizeof(int) * MAX_CHANNEL_BATCH)];
+    } cmsg;
+
+    if (cnt <= 0 || cnt > MAX_CHANNEL_BATCH) {
+        LOG_ERROR("invalid channel batch cnt: %d", cnt);
+        return -1;
+    }
+
+    memset(&cmsg, 0, sizeof(cmsg));
+
+    msg.msg_control = (caddr_t)&cmsg;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * cnt);
+
+    cmsg.cm.cmsg_len = CMSG_LEN(sizeof(int) * cnt);
+    cmsg.cm.cmsg_level = SOL_SOCKET;
+    cmsg.cm.cmsg_type = SCM_RIGHTS;
+
+    for (int i = 0; i < cnt; i++) {
+        ((int*)CMSG_DATA(&cmsg.cm))[i] = chs[i].fd;
+    }
+
+    msg.msg_flags = 0;
+
+    iov[0].iov_base = (char*)chs;
+    iov[0].iov_len = sizeof(channel_t) * cnt;
+
+    msg.msg_name = NULL;
+    msg.msg_namelen = 0;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 1;
+
+    n = sendmsg(fd, &msg, 0);
+
+    if (n == -1) {
+        err = errno;
+        if (err == EAGAIN) {
+            LOG_DEBUG("wait to sendmsg again! err: %d, error: %s",
+                      errno, strerror(errno));
+            return err;
+        }
+        LOG_ERROR("sendmsg() failed! err: %d, error: %s",
+                  errno, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int read_channels(int fd, channel_t* chs, int max, int* cnt, Log* logger) {
+    LOG_TRACE("read from channel, channel fd: %d", fd);
+    ssize_t n;
+    int err = 0, fd_cnt;
+    struct iovec iov[1];
+    struct msghdr msg;
+
+    union {
+        struct cmsghdr cm;
+        char space[CMSG_SPACE(sizeof(int) * MAX_CHANNEL_BATCH)];
+    } cmsg;
+
+    *cnt = 0;
+    if (max > MAX_CHANNEL_BATCH) {
+        max = MAX_CHANNEL_BATCH;
+    }
+
+    iov[0].iov_base = (char*)chs;
+    iov[0].iov_len = sizeof(channel_t) * max;
+
+    msg.msg_name = NULL;
+    msg.msg_namelen = 0;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 1;
+
+    memset(&cmsg, 0, sizeof(cmsg));
+    msg.msg_control = (caddr_t)&cmsg;
+    msg.msg_controllen = sizeof(cmsg);
+
+    /* unix stream socket does not merge messages which carry fds,
+     * so one recvmsg returns one batch at most. */
+    n = recvmsg(fd, &msg, 0);
+
+    if (n == -1) {
+        err = errno;
+        if (err == EAGAIN) {
+            return err;
+        }
+        LOG_ERROR("recvmsg() failed!");
+        return -1;
+    }
+
+    if (n == 0) {
+        LOG_ERROR("rrecvmsg() returned zero! err: %d, error: %s",
+                  errno, strerror(errno));
+        return -1;
+    }
+
+    if ((size_t)n % sizeof(channel_t) != 0) {
+        LOG_ERROR("recvmsg() returned broken data: %zd", n);
+        return -1;
+    }
+
+    if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) {
+        LOG_ERROR("recvmsg() truncated data, err: %d, error: %s",
+                  errno, strerror(errno));
+        return -1;
+    }
+
+    if (cmsg.cm.cmsg_level != SOL_SOCKET || cmsg.cm.cmsg_type != SCM_RIGHTS) {
+        LOG_ERROR(
+            "recvmsg() returned invalid ancillary data "
+            "level %d or type %d, err: %d, error: %s",
+            cmsg.cm.cmsg_level, cmsg.cm.cmsg_type,
+            errno, strerror(errno));
+        return -1;
+    }
+
+    fd_cnt = (cmsg.cm.cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    if (fd_cnt != (int)(n / sizeof(channel_t))) {
+        LOG_ERROR("recvmsg() fds not match records, fds: %d, records: %d",
+                  fd_cnt, (int)(n / sizeof(channel_t)));
+        /* don't leak the fds we got. */
+        for (int i = 0; i < fd_cnt; i++) {
+            close(((int*)CMSG_DATA(&cmsg.cm))[i]);
+        }
+        return -1;
+    }
+
+    for (int i = 0; i < fd_cnt; i++) {
+        chs[i].fd = ((int*)CMSG_DATA(&cmsg.cm))[i];
+    }
+    *cnt = fd_cnt;
+    return 0;
+}
+
 }  // namespace kim
\ No newline at end of file
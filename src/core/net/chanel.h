@@ -11,6 +11,9 @@ extern "C" {
 
 namespace kim {
 
+/* max channel records (and fds) packed into one message. */
+#define MAX_CHANNEL_BATCH 16
+
 typedef struct channel_s {
     int fd;
     int family;
@@ -21,6 +24,11 @@ typedef struct channel_s {
 int write_channel(int fd, channel_t* ch, size_t size, Log* logger = nullptr);
 int read_channel(int fd, channel_t* ch, size_t size, Log* logger = nullptr);
 
+/* batched, cnt records and their fds are sent in one sendmsg. */
+int write_channels(int fd, channel_t* chs, int cnt, Log* logger = nullptr);
+/* read one batch, cnt returns the number of records. */
+int read_channels(int fd, channel_t* chs, int max, int* cnt, Log* logger = nullptr);
+
 }  // namespace kim
 
 #ifdef __cplusplus
@@ -0,0 +1,143 @@
+#include "shm_ring.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <new>
+
+namespace kim {
+
+/* record's len, which fills the tail space of ring. */
+#define SHM_RING_PAD 0xffffffff
+#define SHM_RING_ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+ShmRing::~ShmRing() {
+    if (m_head != nullptr) {
+        munmap(m_head, m_map_len);
+        m_head = nullptr;
+        m_data = nullptr;
+    }
+    if (m_event_fd != -1) {
+        close(m_event_fd);
+        m_event_fd = -1;
+    }
+}
+
+bool ShmRing::init(size_t size) {
+    if (m_head != nullptr || size == 0 || (size & (size - 1)) != 0) {
+        return false;
+    }
+
+    m_map_len = sizeof(ring_head_t) + size;
+    void* p = mmap(nullptr, m_map_len, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+
+    m_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_event_fd == -1) {
+        munmap(p, m_map_len);
+        return false;
+    }
+
+    m_head = new (p) ring_head_t;
+    m_head->w.store(0, std::memory_order_relaxed);
+    m_head->r.store(0, std::memory_order_relaxed);
+    m_data = (char*)p + sizeof(ring_head_t);
+    m_size = size;
+    return true;
+}
+
+char* ShmRing::alloc(uint32_t len) {
+    uint64_t w, r;
+    size_t need, offset, tail;
+
+    need = SHM_RING_ALIGN(sizeof(uint32_t) + len);
+    if (m_head == nullptr || len == SHM_RING_PAD || need > m_size / 2) {
+        return nullptr;
+    }
+
+    w = m_head->w.load(std::memory_order_relaxed);
+    r = m_head->r.load(std::memory_order_acquire);
+    offset = w & (m_size - 1);
+    tail = m_size - offset;
+
+    /* record never wraps, skip the tail if it is not enough. */
+    if (tail < need) {
+        if (w + tail + need - r > m_size) {
+            return nullptr;
+        }
+        *(uint32_t*)(m_data + offset) = SHM_RING_PAD;
+        w += tail;
+        offset = 0;
+    } else if (w + need - r > m_size) {
+        return nullptr;
+    }
+
+    *(uint32_t*)(m_data + offset) = len;
+    m_alloc_pos = w;
+    m_alloc_len = need;
+    return m_data + offset + sizeof(uint32_t);
+}
+
+bool ShmRing::commit() {
+    if (m_alloc_len == 0) {
+        return false;
+    }
+
+    m_head->w.store(m_alloc_pos + m_alloc_len, std::memory_order_release);
+    m_alloc_len = 0;
+    return notify();
+}
+
+bool ShmRing::notify() {
+    /* EAGAIN: counter is full, consumer will be woken up anyway. */
+    uint64_t v = 1;
+    return (write(m_event_fd, &v, sizeof(v)) == sizeof(v) || errno == EAGAIN);
+}
+
+const char* ShmRing::front(uint32_t& len) {
+    uint64_t w, r;
+    size_t offset;
+
+    if (m_head == nullptr) {
+        return nullptr;
+    }
+
+    r = m_head->r.load(std::memory_order_relaxed);
+    w = m_head->w.load(std::memory_order_acquire);
+
+    while (r != w) {
+        offset = r & (m_size - 1);
+        len = *(uint32_t*)(m_data + offset);
+        if (len == SHM_RING_PAD) {
+            r += m_size - offset;
+            m_head->r.store(r, std::memory_order_release);
+            continue;
+        }
+        m_front_len = len;
+        return m_data + offset + sizeof(uint32_t);
+    }
+
+    return nullptr;
+}
+
+void ShmRing::pop() {
+    uint64_t r = m_head->r.load(std::memory_order_relaxed);
+    m_head->r.store(r + SHM_RING_ALIGN(sizeof(uint32_t) + m_front_len),
+                    std::memory_order_release);
+    m_front_len = 0;
+}
+
+void ShmRing::clear_event() {
+    uint64_t v;
+    if (read(m_event_fd, &v, sizeof(v)) < 0) {
+        /* EAGAIN, nothing to clear. */
+    }
+}
+
+}  // namespace kim
@@ -0,0 +1,63 @@
+#ifndef __KIM_SHM_RING_H__
+#define __KIM_SHM_RING_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+
+namespace kim {
+
+/* single producer single consumer ring in shared memory.
+ * it is created before fork(), so parent and child map the same pages,
+ * consumer is woken up by eventfd. records are contiguous:
+ * [uint32 len][data], aligned to 8 bytes. */
+class ShmRing {
+   public:
+    enum {
+        DEFAULT_SIZE = 1024 * 1024, /* must be power of 2. */
+    };
+
+    ShmRing() {}
+    virtual ~ShmRing();
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    bool init(size_t size = DEFAULT_SIZE);
+    int event_fd() const { return m_event_fd; }
+    size_t size() const { return m_size; }
+    /* the largest record which can be allocated. */
+    size_t max_record_len() const { return (m_size / 2) - sizeof(uint32_t); }
+
+    /* producer: alloc space for one record, fill it, then commit. */
+    char* alloc(uint32_t len);
+    bool commit();
+    /* wake up consumer, commit() calls it. */
+    bool notify();
+
+    /* consumer: read the front record in place, then pop. */
+    const char* front(uint32_t& len);
+    void pop();
+    /* reset eventfd's counter before reading records. */
+    void clear_event();
+
+   private:
+    typedef struct ring_head_s {
+        alignas(64) std::atomic<uint64_t> w; /* producer's position. */
+        alignas(64) std::atomic<uint64_t> r; /* consumer's position. */
+    } ring_head_t;
+
+    ring_head_t* m_head = nullptr;
+    char* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_map_len = 0;
+    int m_event_fd = -1;
+    uint64_t m_alloc_pos = 0; /* record allocated, not committed. */
+    uint32_t m_alloc_len = 0;
+    uint32_t m_front_len = 0; /* record read by front. */
+};
+
+}  // namespace kim
+
+#endif  //__KIM_SHM_RING_H__
@@ -3,11 +3,18 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <netinet/in.h>
+#include <strings.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <set>
+
 #include "error.h"
 #include "protobuf/sys/nodes.pb.h"
 
+#define ROUTE_PEEK_LEN 4096        /* bytes of the first request to find session id. */
+#define ROUTE_PEEK_INTERVAL 0.01   /* peek again when the first request is incomplete. */
+
 namespace kim {
 
 Network::Network(Log* logger, TYPE type)
@@ -21,17 +28,40 @@ Network::~Network() {
 void Network::destory() {
     end_ev_loop();
     close_conns();
+    SAFE_DELETE(m_segment_pool);
+
+    if (m_route_peek_timer != nullptr) {
+        m_events->del_timer_event(m_route_peek_timer);
+        m_route_peek_timer = nullptr;
+    }
+
+    for (const auto& it : m_shm_chanels) {
+        m_events->del_io_event(it.second->w);
+        SAFE_DELETE(it.second->send);
+        SAFE_DELETE(it.second->recv);
+        delete it.second;
+    }
+    m_shm_chanels.clear();
 
     for (const auto& it : m_wait_send_fds) free(it);
     m_wait_send_fds.clear();
 
-    for (const auto& it : m_cmds) delete it.second;
+    for (auto& it : m_cmds) Cmd::release(it.second);
     m_cmds.clear();
 
     SAFE_DELETE(m_zk_client);
     SAFE_DELETE(m_db_pool);
     SAFE_DELETE(m_redis_pool);
+    /* the flights which are not called back by pools, detached ones are only in groups. */
+    std::set<flight_t*> flights;
+    for (auto& it : m_flights) flights.insert(it.second);
+    for (auto& it : m_flight_groups) flights.insert(it.second.begin(), it.second.end());
+    for (auto flight : flights) delete flight;
+    m_flights.clear();
+    m_flight_groups.clear();
     SAFE_DELETE(m_session_mgr);
+    /* after cmds and sessions, whose code may be in modules' so. */
+    SAFE_DELETE(m_module_mgr);
     SAFE_DELETE(m_events);
     SAFE_DELETE(m_sys_cmd);
 }
@@ -68,6 +98,27 @@ bool Network::load_config(const CJsonObject& config) {
         set_keep_alive(secs);
     }
 
+    m_conf.Get("reuse_port", m_is_reuse_port);
+    m_conf.Get("shm_chanel", m_is_shm_chanel);
+
+    if (m_conf.Get("http_pipeline_depth", m_pipeline_depth) && m_pipeline_depth < 0) {
+        LOG_ERROR("invalid http_pipeline_depth: %d", m_pipeline_depth);
+        return false;
+    }
+
+    /* connection's buffers are chained by pooled segments. */
+    bool is_chain = false;
+    if (m_conf.Get("chain_buffer", is_chain) && is_chain) {
+        int free_cnt = SegmentPool::DEFAULT_MAX_FREE_CNT;
+        m_conf.Get("chain_buffer_free_cnt", free_cnt);
+        if (free_cnt < 0) {
+            LOG_ERROR("invalid chain_buffer_free_cnt: %d", free_cnt);
+            return false;
+        }
+        m_segment_pool = new SegmentPool(free_cnt);
+        LOG_DEBUG("chain buffer, max free segments: %d", free_cnt);
+    }
+
     m_node_type = m_conf("node_type");
     if (m_node_type.empty()) {
         LOG_ERROR("invalid inner node info!");
@@ -133,21 +184,13 @@ bool Network::create_m(const addr_info* ai, const CJsonObject& config) {
     }
 
     if (!ai->gate_host().empty()) {
-        fd = listen_to_port(ai->gate_host().c_str(), ai->gate_port());
-        if (fd == -1) {
-            LOG_ERROR("listen to gate failed! %s:%d",
-                      ai->gate_host().c_str(), ai->gate_port());
-            return false;
-        }
-
-        m_gate_host_fd = fd;
         m_gate_host = ai->gate_host();
         m_gate_port = ai->gate_port();
-        LOG_INFO("gate fd: %d", m_gate_host_fd);
 
-        if (!add_read_event(m_gate_host_fd, m_gate_codec)) {
-            close_fd(m_gate_host_fd);
-            LOG_ERROR("add read event failed, fd: %d", m_gate_host_fd);
+        if (m_is_reuse_port) {
+            /* workers bind gate port and accept, manager just supervises. */
+            LOG_INFO("gate reuse port mode, %s:%d", m_gate_host.c_str(), m_gate_port);
+        } else if (!listen_to_gate(m_gate_host.c_str(), m_gate_port)) {
             return false;
         }
     }
@@ -155,6 +198,25 @@ bool Network::create_m(const addr_info* ai, const CJsonObject& config) {
     return true;
 }
 
+bool Network::listen_to_gate(const char* host, int port) {
+    int fd = listen_to_port(host, port, m_is_reuse_port);
+    if (fd == -1) {
+        LOG_ERROR("listen to gate failed! %s:%d", host, port);
+        return false;
+    }
+
+    m_gate_host_fd = fd;
+    LOG_INFO("gate fd: %d", m_gate_host_fd);
+
+    if (!add_read_event(m_gate_host_fd, m_gate_codec)) {
+        close_fd(m_gate_host_fd);
+        m_gate_host_fd = -1;
+        LOG_ERROR("add read event failed, fd: %d", fd);
+        return false;
+    }
+    return true;
+}
+
 /* children. */
 bool Network::create_w(const CJsonObject& config, int ctrl_fd, int data_fd, int index) {
     if (!load_public(config)) {
@@ -195,6 +257,15 @@ bool Network::create_w(const CJsonObject& config, int ctrl_fd, int data_fd, int
     m_manager_ctrl_fd = ctrl_fd;
     m_manager_data_fd = data_fd;
     m_worker_index = index;
+
+    if (m_is_reuse_port && !m_conf("gate_host").empty()) {
+        m_gate_host = m_conf("gate_host");
+        m_gate_port = str_to_int(m_conf("gate_port"));
+        if (!listen_to_gate(m_gate_host.c_str(), m_gate_port)) {
+            return false;
+        }
+    }
+
     LOG_INFO("create network done!");
     return true;
 }
@@ -222,6 +293,15 @@ bool Network::load_public(const CJsonObject& config) {
         return false;
     }
 
+    int max_cnt = 0, max_mem = 0;
+    m_conf.Get("session_max_cnt", max_cnt);
+    m_conf.Get("session_max_mem", max_mem);
+    if (max_cnt < 0 || max_mem < 0) {
+        LOG_ERROR("invalid session limits, cnt: %d, mem: %d", max_cnt, max_mem);
+        return false;
+    }
+    m_session_mgr->set_limits(max_cnt, (size_t)max_mem * 1024 * 1024);
+
     m_nodes = new Nodes(m_logger);
     if (m_nodes == nullptr) {
         LOG_ERROR("alloc nodes failed!");
@@ -251,7 +331,6 @@ bool Network::create_events() {
     setup_io_callback();
     setup_io_timer_callback();
     setup_cmd_timer_callback();
-    setup_session_timer_callback();
     return true;
 
 error:
@@ -306,8 +385,7 @@ Connection* Network::add_read_event(int fd, Codec::TYPE codec, bool is_chanel) {
 }
 
 Connection* Network::create_conn(int fd) {
-    auto it = m_conns.find(fd);
-    if (it != m_conns.end()) {
+    if (m_conns.get(fd) != nullptr) {
         LOG_WARN("find old connection, fd: %d", fd);
         close_conn(fd);
     }
@@ -322,9 +400,10 @@ Connection* Network::create_conn(int fd) {
         return nullptr;
     }
 
-    m_conns[fd] = c;
-    c->set_events(m_events);
+    m_conns.set(fd, c);
     c->set_keep_alive(m_keep_alive);
+    c->set_segment_pool(m_segment_pool);
+    c->set_pipeline_depth(m_pipeline_depth);
     LOG_DEBUG("create connection fd: %d, seq: %llu", fd, seq);
     return c;
 }
@@ -344,17 +423,20 @@ bool Network::close_conn(int fd) {
         return false;
     }
 
-    auto it = m_conns.find(fd);
-    if (it == m_conns.end()) {
+    Connection* c = m_conns.remove(fd);
+    if (c == nullptr) {
         return false;
     }
 
-    Connection* c = it->second;
     c->set_state(Connection::STATE::CLOSED);
+    if (c->shm_ring() != nullptr) {
+        del_shm_chanel(fd);
+        c->set_shm_ring(nullptr);
+    }
     m_events->del_io_event(c->get_ev_io());
     c->set_ev_io(nullptr);
 
-    ev_timer* w = c->timer();
+    wheel_timer_t* w = c->timer();
     if (w != nullptr) {
         w->data = nullptr;
         m_events->del_timer_event(w);
@@ -367,15 +449,185 @@ bool Network::close_conn(int fd) {
 
     close_fd(fd);
     SAFE_DELETE(c);
-    m_conns.erase(it);
     return true;
 }
 
-int Network::listen_to_port(const char* host, int port) {
+bool Network::add_shm_chanel(int ctrl_fd, ShmRing* send, ShmRing* recv) {
+    if (send == nullptr || recv == nullptr) {
+        return false;
+    }
+
+    Connection* c = m_conns.get(ctrl_fd);
+    if (c == nullptr || c->is_invalid()) {
+        LOG_ERROR("can not find ctrl chanel, fd: %d", ctrl_fd);
+        return false;
+    }
+
+    ev_io* w = m_events->add_read_event(recv->event_fd(), nullptr, this);
+    if (w == nullptr) {
+        LOG_ERROR("add shm chanel read event failed! fd: %d", recv->event_fd());
+        return false;
+    }
+
+    shm_chanel_t* ch = new shm_chanel_t;
+    ch->ctrl_fd = ctrl_fd;
+    ch->send = send;
+    ch->recv = recv;
+    ch->w = w;
+    m_shm_chanels[recv->event_fd()] = ch;
+    c->set_shm_ring(send);
+
+    LOG_INFO("add shm chanel, ctrl fd: %d, event fd: %d", ctrl_fd, recv->event_fd());
+    return true;
+}
+
+void Network::del_shm_chanel(int ctrl_fd) {
+    for (auto it = m_shm_chanels.begin(); it != m_shm_chanels.end(); it++) {
+        shm_chanel_t* ch = it->second;
+        if (ch->ctrl_fd == ctrl_fd) {
+            LOG_DEBUG("del shm chanel, ctrl fd: %d", ctrl_fd);
+            m_events->del_io_event(ch->w);
+            SAFE_DELETE(ch->send);
+            SAFE_DELETE(ch->recv);
+            SAFE_DELETE(ch);
+            m_shm_chanels.erase(it);
+            return;
+        }
+    }
+}
+
+void Network::read_shm_chanel(shm_chanel_t* ch) {
+    uint32_t len, head_len;
+    const char* data;
+    Connection* c;
+
+    ch->recv->clear_event();
+
+    /* peer is alive, and it may have freed the send ring's space. */
+    flush_shm_chanel(ch);
+
+    c = m_conns.get(ch->ctrl_fd);
+    if (c == nullptr || c->is_invalid()) {
+        LOG_ERROR("can not find ctrl chanel, fd: %d", ch->ctrl_fd);
+        return;
+    }
+
+    Request req(c->fd_data(), false, new google::protobuf::Arena);
+
+    /* record: [uint32 head len][head][body], parsed in place. */
+    while ((data = ch->recv->front(len)) != nullptr) {
+        head_len = *(const uint32_t*)data;
+        if (head_len > len - sizeof(uint32_t) ||
+            !req.msg_head()->ParseFromArray(data + sizeof(uint32_t), head_len) ||
+            !req.msg_body()->ParseFromArray(data + sizeof(uint32_t) + head_len,
+                                            len - sizeof(uint32_t) - head_len)) {
+            LOG_ERROR("parse shm chanel msg failed! ctrl fd: %d", ch->ctrl_fd);
+            ch->recv->pop();
+            req.clear();
+            continue;
+        }
+        ch->recv->pop();
+
+        m_payload.set_read_cnt(m_payload.read_cnt() + 1);
+        m_payload.set_read_bytes(m_payload.read_bytes() + len);
+
+        if (m_sys_cmd->process(req) == Cmd::STATUS::UNKOWN) {
+            LOG_WARN("can not find cmd handler. fd: %d, cmd: %d",
+                     ch->ctrl_fd, req.msg_head()->cmd());
+        }
+        req.clear();
+    }
+}
+
+Network::shm_chanel_t* Network::get_shm_chanel(int ctrl_fd) {
+    for (const auto& it : m_shm_chanels) {
+        if (it.second->ctrl_fd == ctrl_fd) {
+            return it.second;
+        }
+    }
+    return nullptr;
+}
+
+bool Network::send_to_shm(shm_chanel_t* ch, const MsgHead& head, const MsgBody& body) {
+    char* p;
+    uint32_t len, head_len, body_len;
+
+    head_len = head.ByteSizeLong();
+    body_len = body.ByteSizeLong();
+    len = sizeof(uint32_t) + head_len + body_len;
+    if (len > ch->send->max_record_len()) {
+        LOG_ERROR("msg is too large for shm ring! ctrl fd: %d, len: %u",
+                  ch->ctrl_fd, len);
+        return false;
+    }
+
+    m_payload.set_write_cnt(m_payload.write_cnt() + 1);
+    m_payload.set_write_bytes(m_payload.write_bytes() + len);
+
+    /* the older records go first. */
+    flush_shm_chanel(ch);
+
+    p = ch->wait_records.empty() ? ch->send->alloc(len) : nullptr;
+    if (p == nullptr) {
+        /* ring is full, records wait in order, never go through socket. */
+        std::string record(len, '\0');
+        p = &record[0];
+        *(uint32_t*)p = head_len;
+        head.SerializeWithCachedSizesToArray((uint8_t*)p + sizeof(uint32_t));
+        body.SerializeWithCachedSizesToArray((uint8_t*)p + sizeof(uint32_t) + head_len);
+        ch->wait_records.push_back(std::move(record));
+        LOG_WARN("shm ring is full, wait for space! ctrl fd: %d, len: %u, wait cnt: %lu",
+                 ch->ctrl_fd, len, ch->wait_records.size());
+        return true;
+    }
+
+    *(uint32_t*)p = head_len;
+    head.SerializeWithCachedSizesToArray((uint8_t*)p + sizeof(uint32_t));
+    body.SerializeWithCachedSizesToArray((uint8_t*)p + sizeof(uint32_t) + head_len);
+    if (!ch->send->commit()) {
+        /* record is committed, retry to wake up consumer later. */
+        LOG_ERROR("notify shm ring failed! errno: %d", errno);
+        ch->is_notify_failed = true;
+    }
+    return true;
+}
+
+void Network::flush_shm_chanel(shm_chanel_t* ch) {
+    char* p;
+    bool is_committed = false;
+
+    while (!ch->wait_records.empty()) {
+        const std::string& record = ch->wait_records.front();
+        p = ch->send->alloc(record.size());
+        if (p == nullptr) {
+            break;
+        }
+        memcpy(p, record.data(), record.size());
+        ch->send->commit();
+        ch->wait_records.pop_front();
+        is_committed = true;
+    }
+
+    if (is_committed || ch->is_notify_failed) {
+        ch->is_notify_failed = !ch->send->notify();
+        if (ch->is_notify_failed) {
+            LOG_ERROR("notify shm ring failed! ctrl fd: %d, errno: %d",
+                      ch->ctrl_fd, errno);
+        }
+    }
+}
+
+void Network::flush_shm_chanels() {
+    for (const auto& it : m_shm_chanels) {
+        flush_shm_chanel(it.second);
+    }
+}
+
+int Network::listen_to_port(const char* host, int port, bool reuse_port) {
     int fd = -1;
     char errstr[256];
 
-    fd = anet_tcp_server(errstr, host, port, TCP_BACK_LOG);
+    fd = anet_tcp_server(errstr, host, port, TCP_BACK_LOG, reuse_port);
     if (fd == -1) {
         LOG_ERROR("bind tcp ipv4 failed! %s", errstr);
         return -1;
@@ -399,31 +651,40 @@ void Network::close_chanel(int* fds) {
 
 void Network::close_conns() {
     LOG_TRACE("close_conns(), cnt: %d", m_conns.size());
-    for (const auto& it : m_conns) {
-        close_conn(it.second);
-    }
+    m_conns.for_each([this](Connection* c) { close_conn(c); });
+    m_route_fds.for_each([this](route_fd_t* r) { del_route_fd(r->fd, true); });
 }
 
 void Network::close_fds() {
-    for (const auto& it : m_conns) {
-        Connection* c = it.second;
+    m_conns.for_each([this](Connection* c) {
         if (!c->is_invalid()) {
             close_conn(c);
         }
-    }
+    });
+    m_route_fds.for_each([this](route_fd_t* r) { del_route_fd(r->fd, true); });
 }
 
 bool Network::check_conn(int fd) {
-    auto it = m_conns.find(fd);
-    return ((it != m_conns.end() && !it->second->is_invalid()));
+    Connection* c = m_conns.get(fd);
+    return (c != nullptr && !c->is_invalid());
 }
 
 void Network::on_io_read(int fd) {
+    if (!m_shm_chanels.empty()) {
+        auto it = m_shm_chanels.find(fd);
+        if (it != m_shm_chanels.end()) {
+            read_shm_chanel(it->second);
+            return;
+        }
+    }
+
     if (is_manager()) {
         if (fd == m_node_host_fd) {
             accept_server_conn(fd);
         } else if (fd == m_gate_host_fd) {
             accept_and_transfer_fd(fd);
+        } else if (m_route_fds.get(fd) != nullptr) {
+            route_fd(m_route_fds.get(fd), false);
         } else {
             read_query_from_client(fd);
         }
@@ -431,6 +692,8 @@ void Network::on_io_read(int fd) {
         if (fd == m_manager_data_fd) {
             LOG_TRACE("on io read manager data fd: %d", fd);
             read_transfer_fd(fd);
+        } else if (fd == m_gate_host_fd) {
+            accept_gate_conn(fd);
         } else {
             read_query_from_client(fd);
         }
@@ -438,13 +701,12 @@ void Network::on_io_read(int fd) {
 }
 
 void Network::on_io_write(int fd) {
-    auto it = m_conns.find(fd);
-    if (it == m_conns.end() || it->second == nullptr) {
+    Connection* c = m_conns.get(fd);
+    if (c == nullptr) {
         LOG_ERROR("find connection failed! fd: %d", fd);
         return;
     }
 
-    Connection* c = it->second;
     if (c->is_invalid()) {
         LOG_WARN("invalid conn in write event! fd: %d", c->fd());
         close_conn(c);
@@ -468,8 +730,12 @@ void Network::on_io_write(int fd) {
 }
 
 void Network::on_repeat_timer(void* privdata) {
+    /* records which wait for shm ring's space. */
+    flush_shm_chanels();
+
     if (is_manager()) {
         check_wait_send_fds();
+        check_route_fds();
         if (m_zk_client != nullptr) {
             m_zk_client->on_repeat_timer();
         }
@@ -477,11 +743,18 @@ void Network::on_repeat_timer(void* privdata) {
     } else {
         /* send payload info to parent. */
         report_payload_to_parent();
+        if (m_module_mgr != nullptr) {
+            m_module_mgr->on_repeat_timer();
+        }
     }
 
     if (m_sys_cmd != nullptr) {
         m_sys_cmd->on_repeat_timer();
     }
+
+    if (m_session_mgr != nullptr) {
+        m_session_mgr->on_repeat_timer();
+    }
 }
 
 bool Network::report_payload_to_parent() {
@@ -493,7 +766,26 @@ bool Network::report_payload_to_parent() {
     m_payload.set_worker_index(worker_index());
     m_payload.set_cmd_cnt(m_cmds.size());
     m_payload.set_conn_cnt(m_conns.size() + m_node_conns.size());
-    m_payload.set_create_time(now());
+    m_payload.set_create_time(Clock::wall_time());
+    if (m_module_mgr != nullptr) {
+        m_module_mgr->get_cmd_pool_stats(m_payload);
+    }
+    if (m_redis_pool != nullptr) {
+        m_redis_pool->get_stats(m_payload);
+    }
+    if (m_session_mgr != nullptr) {
+        SessionStats* ss = m_payload.mutable_sessions();
+        ss->set_cnt(m_session_mgr->size());
+        ss->set_bytes(m_session_mgr->bytes());
+        ss->set_hit_cnt(m_session_mgr->hit_cnt());
+        ss->set_miss_cnt(m_session_mgr->miss_cnt());
+        ss->set_evict_cnt(m_session_mgr->evict_cnt());
+        ss->set_expire_cnt(m_session_mgr->expire_cnt());
+        if (m_session_mgr->hit_cnt() + m_session_mgr->miss_cnt() > 0) {
+            ss->set_hit_rate((double)m_session_mgr->hit_cnt() /
+                             (m_session_mgr->hit_cnt() + m_session_mgr->miss_cnt()));
+        }
+    }
 
     if (!m_sys_cmd->send_parent_payload(m_payload)) {
         m_payload.Clear();
@@ -515,7 +807,7 @@ bool Network::report_payload_to_zookeeper() {
     Payload *manager_pls, *worker_pls;
     std::string json_data;
     int cmd_cnt = 0, conn_cnt = 0, read_cnt = 0, write_cnt = 0,
-        read_bytes = 0, write_bytes = 0;
+        read_bytes = 0, write_bytes = 0, dispatch_cnt = 0;
     const std::unordered_map<int, worker_info_t*>& infos =
         m_worker_data_mgr->get_infos();
 
@@ -528,6 +820,7 @@ bool Network::report_payload_to_zookeeper() {
     node->set_gate_host(m_gate_host);
     node->set_gate_port(m_gate_port);
     node->set_worker_cnt(infos.size());
+    node->set_dispatch(WorkerDataMgr::dispatch_name(m_worker_data_mgr->dispatch()));
 
     /* worker payload infos. */
     for (const auto& it : infos) {
@@ -537,13 +830,21 @@ bool Network::report_payload_to_zookeeper() {
         read_bytes += it.second->payload.read_bytes();
         write_cnt += it.second->payload.write_cnt();
         write_bytes += it.second->payload.write_bytes();
+        dispatch_cnt += it.second->dispatch_cnt;
         worker_pls = pls.add_workers();
         *worker_pls = it.second->payload;
+        worker_pls->set_dispatch_cnt(it.second->dispatch_cnt);
         if (it.second->payload.worker_index() == 0) {
             worker_pls->set_worker_index(it.second->index);
         }
     }
 
+    for (int i = 0; i < static_cast<int>(WorkerDataMgr::DISPATCH::COUNT); i++) {
+        auto type = static_cast<WorkerDataMgr::DISPATCH>(i);
+        (*pls.mutable_dispatch_cnts())[WorkerDataMgr::dispatch_name(type)] =
+            m_worker_data_mgr->dispatch_cnt(type);
+    }
+
     /* manager statistics data results。 */
     manager_pls = pls.mutable_manager();
     manager_pls->set_worker_index(worker_index());
@@ -553,7 +854,8 @@ bool Network::report_payload_to_zookeeper() {
     manager_pls->set_read_bytes(read_bytes + m_payload.read_bytes());
     manager_pls->set_write_cnt(write_cnt + m_payload.write_cnt());
     manager_pls->set_write_bytes(write_bytes + m_payload.write_bytes());
-    manager_pls->set_create_time(now());
+    manager_pls->set_dispatch_cnt(dispatch_cnt);
+    manager_pls->set_create_time(Clock::wall_time());
 
     m_payload.Clear();
 
@@ -620,6 +922,7 @@ void Network::on_cmd_timer(void* privdata) {
     old = cmd->cur_timeout_cnt();
     status = cmd->on_timeout();
     if (status != Cmd::STATUS::RUNNING) {
+        check_http_response(cmd->req(), 504);
         del_cmd(cmd);
         return;
     }
@@ -638,6 +941,7 @@ void Network::on_cmd_timer(void* privdata) {
 
     if (cmd->cur_timeout_cnt() >= cmd->max_timeout_cnt()) {
         LOG_WARN("pls check timeout logic! %s", cmd->name());
+        check_http_response(cmd->req(), 504);
         del_cmd(cmd);
         return;
     }
@@ -667,14 +971,13 @@ void Network::on_io_timer(void* privdata) {
 }
 
 bool Network::read_query_from_client(int fd) {
-    auto it = m_conns.find(fd);
-    if (it == m_conns.end() || it->second == nullptr) {
+    Connection* c = m_conns.get(fd);
+    if (c == nullptr) {
         LOG_WARN("find connection failed, fd: %d", fd);
         close_conn(fd);
         return false;
     }
 
-    Connection* c = it->second;
     if (c->is_invalid()) {
         close_conn(fd);
         return false;
@@ -699,7 +1002,8 @@ bool Network::process_tcp_msg(Connection* c) {
     int fd;
     Cmd::STATUS cmd_ret;
     Codec::STATUS codec_ret;
-    Request req(c->fd_data(), false);
+    /* decode batch's msgs are allocated on an arena. */
+    Request req(c->fd_data(), false, new google::protobuf::Arena);
     uint32_t old_cnt, old_bytes;
 
     fd = c->fd();
@@ -743,8 +1047,7 @@ bool Network::process_tcp_msg(Connection* c) {
             LOG_TRACE("process tcp msg failed! fd: %d", fd);
         }
 
-        req.msg_head()->Clear();
-        req.msg_body()->Clear();
+        req.clear();
         cmd_ret = Cmd::STATUS::UNKOWN;
 
         codec_ret = c->fetch_data(*req.msg_head(), *req.msg_body());
@@ -767,11 +1070,10 @@ error:
 }
 
 bool Network::process_http_msg(Connection* c) {
-    HttpMsg msg;
     int old_cnt, old_bytes;
     Cmd::STATUS cmd_ret;
     Codec::STATUS codec_ret;
-    Request req(c->fd_data(), true);
+    Request req(c->fd_data(), true, new google::protobuf::Arena);
 
     old_cnt = c->read_cnt();
     old_bytes = c->read_bytes();
@@ -785,12 +1087,28 @@ bool Network::process_http_msg(Connection* c) {
     LOG_TRACE("connection is http, read ret: %d", (int)codec_ret);
 
     while (codec_ret == Codec::STATUS::OK) {
+        c->set_http_cur_seq(req.http_msg()->seq());
         cmd_ret = m_module_mgr->process_req(req);
-        msg.Clear();
+        c->set_http_cur_seq(0);
+        if (cmd_ret == Cmd::STATUS::UNKOWN) {
+            LOG_WARN("can not find http handler. fd: %d, path: %s",
+                     c->fd(), req.http_msg()->path().c_str());
+        }
+        if (cmd_ret != Cmd::STATUS::RUNNING &&
+            !check_http_response(&req, (cmd_ret == Cmd::STATUS::UNKOWN) ? 404 : 500)) {
+            return false;
+        }
+        req.clear();
         codec_ret = c->fetch_data(*req.http_msg());
         LOG_TRACE("cmd status: %d", cmd_ret);
     }
 
+    /* too many requests in processing, stop reading until responses are sent. */
+    if (codec_ret == Codec::STATUS::PAUSE && c->is_pipeline_full()) {
+        c->set_pipeline_paused(true);
+        m_events->del_read_event(c->get_ev_io());
+    }
+
     if (codec_ret == Codec::STATUS::ERR || codec_ret == Codec::STATUS::CLOSED) {
         LOG_TRACE("conn read failed. fd: %d", c->fd());
         close_conn(c);
@@ -800,6 +1118,33 @@ bool Network::process_http_msg(Connection* c) {
     return true;
 }
 
+bool Network::check_http_response(const Request* req, int status_code) {
+    if (req == nullptr || !req->is_http()) {
+        return true;
+    }
+
+    const HttpMsg* req_msg = req->http_msg();
+    if (req_msg == nullptr || req_msg->seq() == 0) {
+        return true;
+    }
+
+    Connection* c = get_conn(req->fd_data());
+    if (c == nullptr || c->is_invalid() || c->is_responded(req_msg->seq())) {
+        return true;
+    }
+
+    /* the later pipelined responses wait for it. */
+    LOG_WARN("request has no response! fd: %d, seq: %u, status: %d",
+             c->fd(), req_msg->seq(), status_code);
+    HttpMsg msg;
+    msg.set_type(HTTP_RESPONSE);
+    msg.set_status_code(status_code);
+    msg.set_http_major(req_msg->http_major());
+    msg.set_http_minor(req_msg->http_minor());
+    msg.set_seq(req_msg->seq());
+    return send_to(c, msg);
+}
+
 void Network::accept_server_conn(int listen_fd) {
     Connection* c;
     char ip[NET_IP_STR_LEN];
@@ -827,60 +1172,326 @@ void Network::accept_server_conn(int listen_fd) {
     }
 }
 
-/* manager accept new fd and transfer which to worker through chanel.*/
+/* reuse port mode, worker accepts gate connections by itself. */
+void Network::accept_gate_conn(int listen_fd) {
+    Connection* c;
+    char ip[NET_IP_STR_LEN];
+    int fd, port, family, max = MAX_ACCEPTS_PER_CALL;
+
+    while (max--) {
+        fd = anet_tcp_accept(m_errstr, listen_fd, ip, sizeof(ip), &port, &family);
+        if (fd == ANET_ERR) {
+            if (errno != EWOULDBLOCK) {
+                LOG_ERROR("accepting client connection failed: fd: %d, errstr %s",
+                          listen_fd, m_errstr);
+            }
+            return;
+        }
+
+        LOG_TRACE("accepted client %s:%d, fd: %d", ip, port, fd);
+
+        c = add_read_event(fd, m_gate_codec);
+        if (c == nullptr) {
+            close_conn(fd);
+            LOG_ERROR("add read event failed, client fd: %d", fd);
+            return;
+        }
+
+        if (!add_io_timer(c, m_keep_alive)) {
+            return;
+        }
+    }
+}
+
+/* manager accept new fds and transfer which to workers through chanel,
+ * fds accepted in one call are packed into one message per worker. */
 void Network::accept_and_transfer_fd(int listen_fd) {
-    channel_t ch;
-    chanel_resend_data_t* ch_data;
     char ip[NET_IP_STR_LEN] = {0};
-    int fd, port, family, chanel_fd, err;
+    int fd, port, family, chanel_fd, max = MAX_ACCEPTS_PER_CALL;
+    /* key: chanel fd. */
+    std::unordered_map<int, std::vector<channel_t>> batches;
+
+    while (max--) {
+        fd = anet_tcp_accept(m_errstr, listen_fd, ip, sizeof(ip), &port, &family);
+        if (fd == ANET_ERR) {
+            if (errno != EWOULDBLOCK) {
+                LOG_WARN("accepting client connection: %s", m_errstr);
+            }
+            break;
+        }
 
-    fd = anet_tcp_accept(m_errstr, listen_fd, ip, sizeof(ip), &port, &family);
-    if (fd == ANET_ERR) {
-        if (errno != EWOULDBLOCK) {
-            LOG_WARN("accepting client connection: %s", m_errstr);
+        LOG_INFO("accepted client: %s:%d, fd: %d", ip, port, fd);
+
+        if (m_worker_data_mgr->dispatch() == WorkerDataMgr::DISPATCH::SESSION) {
+            /* wait for the first request to find its session id. */
+            add_route_fd(fd, family);
+            continue;
+        }
+
+        chanel_fd = m_worker_data_mgr->get_next_worker_data_fd(ip);
+        if (chanel_fd <= 0) {
+            LOG_ERROR("find next worker chanel failed!");
+            close_fd(fd);
+            continue;
         }
-        return;
-    }
 
-    LOG_INFO("accepted client: %s:%d, fd: %d", ip, port, fd);
+        LOG_TRACE("send client fd: %d to worker through chanel fd %d", fd, chanel_fd);
 
-    chanel_fd = m_worker_data_mgr->get_next_worker_data_fd();
-    if (chanel_fd <= 0) {
-        LOG_ERROR("find next worker chanel failed!");
-        goto end;
+        std::vector<channel_t>& chs = batches[chanel_fd];
+        chs.push_back({fd, family, static_cast<int>(m_gate_codec), 0});
+        if (chs.size() >= MAX_CHANNEL_BATCH) {
+            transfer_fds(chanel_fd, chs);
+            chs.clear();
+        }
+    }
+
+    for (auto& it : batches) {
+        if (!it.second.empty()) {
+            transfer_fds(it.first, it.second);
+        }
     }
+}
 
-    LOG_TRACE("send client fd: %d to worker through chanel fd %d", fd, chanel_fd);
+void Network::transfer_fds(int chanel_fd, std::vector<channel_t>& chs) {
+    chanel_resend_data_t* ch_data;
+    int err = write_channels(chanel_fd, chs.data(), chs.size(), m_logger);
+    if (err == 0) {
+        /* workers own the fds now. */
+        for (auto& ch : chs) {
+            close_fd(ch.fd);
+        }
+        return;
+    }
 
-    ch = {fd, family, static_cast<int>(m_gate_codec), 0};
-    err = write_channel(chanel_fd, &ch, sizeof(channel_t), m_logger);
-    if (err != 0) {
+    for (auto& ch : chs) {
         if (err == EAGAIN) {
             ch_data = (chanel_resend_data_t*)malloc(sizeof(chanel_resend_data_t));
             memset(ch_data, 0, sizeof(chanel_resend_data_t));
             ch_data->ch = ch;
             m_wait_send_fds.push_back(ch_data);
-            LOG_TRACE("wait to write channel, errno: %d", err);
-            return;
+        } else {
+            close_fd(ch.fd);
         }
-        LOG_ERROR("write channel failed! errno: %d", err);
     }
 
-end:
-    close_fd(fd);
+    if (err == EAGAIN) {
+        LOG_TRACE("wait to write channel, errno: %d, cnt: %lu", err, chs.size());
+    } else {
+        LOG_ERROR("write channel failed! errno: %d, cnt: %lu", err, chs.size());
+    }
 }
 
-// worker send fd which transfered from manager.
+bool Network::add_route_fd(int fd, int family) {
+    if (anet_no_block(m_errstr, fd) != ANET_OK) {
+        LOG_ERROR("set socket no block failed! fd: %d, errstr: %s", fd, m_errstr);
+        close_fd(fd);
+        return false;
+    }
+
+    route_fd_t* r = new route_fd_t;
+    r->fd = fd;
+    r->family = family;
+    r->accept_time = now();
+    r->w = m_events->add_read_event(fd, nullptr, this);
+    if (r->w == nullptr) {
+        LOG_ERROR("add route fd read event failed! fd: %d", fd);
+        SAFE_DELETE(r);
+        close_fd(fd);
+        return false;
+    }
+
+    m_route_fds.set(fd, r);
+    return true;
+}
+
+void Network::del_route_fd(int fd, bool is_close) {
+    route_fd_t* r = m_route_fds.remove(fd);
+    if (r == nullptr) {
+        return;
+    }
+    m_events->del_io_event(r->w);
+    if (is_close) {
+        close_fd(fd);
+    }
+    SAFE_DELETE(r);
+}
+
+/* peek the first request and leave it in socket buffer for the worker,
+ * the fd without session id goes to the least loaded worker. */
+void Network::route_fd(route_fd_t* r, bool is_timeout) {
+    ssize_t n;
+    std::string sessid;
+    char buf[ROUTE_PEEK_LEN];
+    int chanel_fd, fd = r->fd, family = r->family;
+
+    n = recv(fd, buf, sizeof(buf), MSG_PEEK);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        LOG_DEBUG("client closed before request, fd: %d", fd);
+        del_route_fd(fd, true);
+        return;
+    }
+
+    if (n < 0 && !is_timeout) {
+        return;
+    }
+
+    /* wait for the whole first request, or the limits, then fall back. */
+    if (n > 0 && !peek_sessid(buf, n, sessid) && !is_timeout &&
+        (size_t)n < sizeof(buf) && !is_peek_done(buf, n)) {
+        if (!r->is_peek_waiting) {
+            /* level triggered read event fires again and again for the peeked data. */
+            r->is_peek_waiting = true;
+            m_events->del_read_event(r->w);
+        }
+        if (m_route_peek_timer == nullptr || !ev_is_active(m_route_peek_timer)) {
+            m_route_peek_timer = m_events->add_timer_event(
+                ROUTE_PEEK_INTERVAL, m_route_peek_timer, &on_route_peek_timer, this);
+            if (m_route_peek_timer == nullptr) {
+                LOG_ERROR("add route peek timer failed! fd: %d", fd);
+            }
+        }
+        return;
+    }
+    del_route_fd(fd, false);
+
+    chanel_fd = m_worker_data_mgr->get_next_worker_data_fd(nullptr, sessid.c_str());
+    if (chanel_fd <= 0) {
+        LOG_ERROR("find worker chanel failed! fd: %d, sessid: %s", fd, sessid.c_str());
+        close_fd(fd);
+        return;
+    }
+
+    LOG_TRACE("route client fd: %d, sessid: %s, chanel fd: %d",
+              fd, sessid.c_str(), chanel_fd);
+
+    std::vector<channel_t> chs;
+    chs.push_back({fd, family, static_cast<int>(m_gate_codec), 0});
+    transfer_fds(chanel_fd, chs);
+}
+
+void Network::check_route_fds() {
+    double now_time = now();
+    m_route_fds.for_each([this, now_time](route_fd_t* r) {
+        if (now_time - r->accept_time >= ROUTE_TIMEOUT_VAL) {
+            route_fd(r, true);
+        }
+    });
+}
+
+void Network::on_route_peek_timer(struct ev_loop* loop, ev_timer* w, int revents) {
+    Network* net = static_cast<Network*>(w->data);
+    net->check_route_peeks();
+}
+
+void Network::check_route_peeks() {
+    double now_time = now();
+    m_route_fds.for_each([this, now_time](route_fd_t* r) {
+        if (r->is_peek_waiting) {
+            route_fd(r, now_time - r->accept_time >= ROUTE_TIMEOUT_VAL);
+        }
+    });
+}
+
+/* http: headers end with an empty line, the body is not needed.
+ * protobuf: the first message is complete. */
+bool Network::is_peek_done(const char* data, size_t len) {
+    if (m_gate_codec == Codec::TYPE::PROTOBUF) {
+        MsgHead head;
+        if (len < PROTO_MSG_HEAD_LEN) {
+            return false;
+        }
+        /* broken head, no need to wait. */
+        return (!head.ParseFromArray(data, PROTO_MSG_HEAD_LEN) ||
+                len >= (size_t)(PROTO_MSG_HEAD_LEN + head.len()));
+    }
+
+    if (m_gate_codec == Codec::TYPE::HTTP) {
+        return (memmem(data, len, "\r\n\r\n", 4) != nullptr);
+    }
+    return true;
+}
+
+/* http: param in request line's query string or header, like
+ * "GET /test?sessid=123 HTTP/1.1" or "sessid: 123".
+ * protobuf: the route of request in the first message. */
+bool Network::peek_sessid(const char* data, size_t len, std::string& sessid) {
+    const std::string& key = m_session_route_key;
+
+    if (m_gate_codec == Codec::TYPE::PROTOBUF) {
+        MsgHead head;
+        MsgBody body;
+        if (len < PROTO_MSG_HEAD_LEN || !head.ParseFromArray(data, PROTO_MSG_HEAD_LEN) ||
+            head.len() <= 0 || len < (size_t)(PROTO_MSG_HEAD_LEN + head.len()) ||
+            !body.ParseFromArray(data + PROTO_MSG_HEAD_LEN, head.len())) {
+            return false;
+        }
+        sessid = body.req_target().route();
+        return !sessid.empty();
+    }
+
+    if (m_gate_codec != Codec::TYPE::HTTP || key.empty()) {
+        return false;
+    }
+
+    const char *p, *e, *v;
+    const char* end = data + len;
+    const char* eol = (const char*)memmem(data, len, "\r\n", 2);
+    if (eol == nullptr) {
+        eol = end;
+    }
+
+    /* query string. */
+    p = (const char*)memchr(data, '?', eol - data);
+    if (p != nullptr) {
+        const char* qend = (const char*)memchr(p, ' ', eol - p);
+        if (qend == nullptr) {
+            qend = eol;
+        }
+        for (p++; p < qend; p = e + 1) {
+            e = (const char*)memchr(p, '&', qend - p);
+            if (e == nullptr) {
+                e = qend;
+            }
+            if ((size_t)(e - p) > key.size() && p[key.size()] == '=' &&
+                memcmp(p, key.data(), key.size()) == 0) {
+                sessid.assign(p + key.size() + 1, e);
+                return !sessid.empty();
+            }
+        }
+    }
+
+    if (eol == end) {
+        return false;
+    }
+
+    /* headers, stop at the empty line or the incomplete one. */
+    for (p = eol + 2; p < end; p = e + 2) {
+        e = (const char*)memmem(p, end - p, "\r\n", 2);
+        if (e == nullptr || e == p) {
+            break;
+        }
+        if ((size_t)(e - p) > key.size() && p[key.size()] == ':' &&
+            strncasecmp(p, key.data(), key.size()) == 0) {
+            v = p + key.size() + 1;
+            while (v < e && (*v == ' ' || *v == '\t')) v++;
+            while (e > v && (e[-1] == ' ' || e[-1] == '\t')) e--;
+            sessid.assign(v, e);
+            return !sessid.empty();
+        }
+    }
+    return false;
+}
+
+// worker read fds which transfered from manager.
 void Network::read_transfer_fd(int fd) {
-    ev_timer* w;
-    channel_t ch;
     Connection* c;
     Codec::TYPE codec;
-    int err, max = MAX_ACCEPTS_PER_CALL;
+    channel_t chs[MAX_CHANNEL_BATCH];
+    int i, err, cnt, max = MAX_ACCEPTS_PER_CALL;
 
-    while (max--) {
-        // read fd from manager.
-        err = read_channel(fd, &ch, sizeof(channel_t), m_logger);
+    while (max > 0) {
+        // read fds from manager.
+        err = read_channels(fd, chs, MAX_CHANNEL_BATCH, &cnt, m_logger);
         if (err != 0) {
             if (err == EAGAIN) {
                 LOG_TRACE("read channel again next time! channel fd: %d", fd);
@@ -892,36 +1503,28 @@ void Network::read_transfer_fd(int fd) {
             }
         }
 
-        LOG_TRACE("read from channel, get data: fd: %d, family: %d, codec: %d, system: %d",
-                  ch.fd, ch.family, ch.codec, ch.is_system);
+        max -= cnt;
 
-        codec = static_cast<Codec::TYPE>(ch.codec);
-        c = add_read_event(ch.fd, codec);
-        if (c == nullptr) {
-            LOG_ERROR("add data fd read event failed, fd: %d", ch.fd);
-            goto error;
-        }
+        for (i = 0; i < cnt; i++) {
+            const channel_t& ch = chs[i];
+            LOG_TRACE("read from channel, get data: fd: %d, family: %d, codec: %d, system: %d",
+                      ch.fd, ch.family, ch.codec, ch.is_system);
 
-        if (ch.is_system) {
-            c->set_system(true);
-        }
+            codec = static_cast<Codec::TYPE>(ch.codec);
+            c = add_read_event(ch.fd, codec);
+            if (c == nullptr) {
+                LOG_ERROR("add data fd read event failed, fd: %d", ch.fd);
+                close_conn(ch.fd);
+                continue;
+            }
 
-        // add timer.
-        LOG_TRACE("add io timer, fd: %d, time val: %f", ch.fd, m_keep_alive);
-        w = m_events->add_io_timer(m_keep_alive, c->timer(), c);
-        if (w == nullptr) {
-            LOG_ERROR("add timer failed! fd: %d", ch.fd);
-            goto error;
-        }
+            if (ch.is_system) {
+                c->set_system(true);
+            }
 
-        c->set_timer(w);
+            add_io_timer(c, m_keep_alive);
+        }
     }
-
-    return;
-
-error:
-    close_conn(ch.fd);
-    return;
 }
 
 void Network::end_ev_loop() {
@@ -999,13 +1602,13 @@ bool Network::send_to_children(int cmd, uint64_t seq, const std::string& data) {
         m_worker_data_mgr->get_infos();
 
     for (auto& v : infos) {
-        auto it = m_conns.find(v.second->ctrl_fd);
-        if (it == m_conns.end() || it->second->is_invalid()) {
+        Connection* c = m_conns.get(v.second->ctrl_fd);
+        if (c == nullptr || c->is_invalid()) {
             LOG_ALERT("ctrl fd is invalid! fd: %d", v.second->ctrl_fd);
             continue;
         }
 
-        if (!send_req(it->second, cmd, seq, data)) {
+        if (!send_req(c, cmd, seq, data)) {
             LOG_ALERT("send to child failed! fd: %d", v.second->ctrl_fd);
             continue;
         }
@@ -1020,13 +1623,13 @@ bool Network::send_to_parent(int cmd, uint64_t seq, const std::string& data) {
         return false;
     }
 
-    auto it = m_conns.find(m_manager_ctrl_fd);
-    if (it == m_conns.end()) {
+    Connection* c = m_conns.get(m_manager_ctrl_fd);
+    if (c == nullptr) {
         LOG_ERROR("can not find manager ctrl fd, fd: %d", m_manager_ctrl_fd);
         return false;
     }
 
-    if (!send_req(it->second, cmd, seq, data)) {
+    if (!send_req(c, cmd, seq, data)) {
         LOG_ALERT("send to parent failed! fd: %d", m_manager_ctrl_fd);
         return false;
     }
@@ -1136,11 +1739,22 @@ bool Network::send_to(Connection* c, const HttpMsg& msg) {
     }
 
     if (!handle_write_events(c, msg)) {
-        close_conn(c);
         LOG_WARN("handle write event failed! fd: %d", c->fd());
+        close_conn(c);
         return false;
     }
 
+    if (c->is_pipeline_paused() && !c->is_pipeline_full()) {
+        /* decode the requests left in buffer, then read again. */
+        c->set_pipeline_paused(false);
+        if (m_events->add_read_event(c->fd(), c->get_ev_io(), this) == nullptr) {
+            LOG_ERROR("add read event failed! fd: %d", c->fd());
+            close_conn(c);
+            return false;
+        }
+        process_http_msg(c);
+    }
+
     return true;
 }
 
@@ -1149,6 +1763,14 @@ bool Network::send_to(Connection* c, const MsgHead& head, const MsgBody& body) {
         return false;
     }
 
+    /* once shm chanel is used, all ctrl msgs go through it to keep the order. */
+    if (c->shm_ring() != nullptr) {
+        shm_chanel_t* ch = get_shm_chanel(c->fd());
+        if (ch != nullptr) {
+            return send_to_shm(ch, head, body);
+        }
+    }
+
     if (!handle_write_events(c, head, body)) {
         close_conn(c);
         LOG_WARN("handle write event failed! fd: %d", c->fd());
@@ -1159,8 +1781,9 @@ bool Network::send_to(Connection* c, const MsgHead& head, const MsgBody& body) {
 }
 
 Connection* Network::get_conn(const fd_t& f) {
-    auto it = m_conns.find(f.fd);
-    return (it == m_conns.end() || it->second->id() != f.id) ? nullptr : it->second;
+    /* fd may be reused, connection's id checks it. */
+    Connection* c = m_conns.get(f.fd);
+    return (c == nullptr || c->id() != f.id) ? nullptr : c;
 }
 
 bool Network::send_to(const fd_t& f, const HttpMsg& msg) {
@@ -1278,11 +1901,11 @@ bool Network::handle_write_events(Connection* c, Codec::STATUS codec_ret) {
     return true;
 }
 
-ev_timer* Network::add_cmd_timer(double secs, ev_timer* w, void* privdata) {
+wheel_timer_t* Network::add_cmd_timer(double secs, wheel_timer_t* w, void* privdata) {
     return m_events->add_cmd_timer(secs, w, privdata);
 }
 
-bool Network::del_cmd_timer(ev_timer* w) {
+bool Network::del_cmd_timer(wheel_timer_t* w) {
     return m_events->del_timer_event(w);
 }
 
@@ -1297,6 +1920,41 @@ bool Network::redis_send_to(const char* node, Cmd* cmd, const std::vector<std::s
     uint64_t cmd_id;
     wait_cmd_info_t* index;
 
+    std::string group(format_str("r:%s", node));
+
+    if (RedisMgr::is_readonly_cmd(argv)) {
+        std::string key(format_str("r:%s:", node));
+        for (const auto& arg : argv) {
+            key.append(std::to_string(arg.length())).append(":").append(arg);
+        }
+        if (join_flight(key, cmd)) {
+            return true;
+        }
+
+        /* args may be keys, a write to any of them detaches the flight. */
+        std::vector<std::string> groups{group};
+        for (size_t i = 1; i < argv.size(); i++) {
+            groups.push_back(group + ":" + argv[i]);
+        }
+        flight_t* flight = add_flight(key, cmd, std::move(groups));
+        if (!m_redis_pool->send_to(node, argv, on_redis_flight_lib_callback, flight)) {
+            LOG_ERROR("redis send data failed! node: %s.", node);
+            del_flight(flight);
+            return false;
+        }
+        return true;
+    }
+
+    /* read your writes: the reads in flight may be sent before the write
+     * through other connections, so the later reads must not share them. */
+    if (RedisCluster::key_index(argv) < 0) {
+        detach_flights(group);
+    } else {
+        for (size_t i = 1; i < argv.size(); i++) {
+            detach_flights(group + ":" + argv[i]);
+        }
+    }
+
     // delete index when callback.
     cmd_id = cmd->id();
     index = new wait_cmd_info_t{this, cmd_id, cmd->get_cur_step()};
@@ -1325,6 +1983,9 @@ bool Network::db_exec(const char* node, const char* sql, Cmd* cmd) {
     uint64_t cmd_id;
     wait_cmd_info_t* index;
 
+    /* sql's tables are unknown, the node's queries in flight are detached. */
+    detach_flights(format_str("d:%s", node));
+
     cmd_id = cmd->id();
     index = new wait_cmd_info_t{this, cmd_id, cmd->get_cur_step()};
     if (index == nullptr) {
@@ -1349,25 +2010,129 @@ bool Network::db_query(const char* node, const char* sql, Cmd* cmd) {
 
     LOG_DEBUG("database query, node: %s, sql: %s", node, sql);
 
-    uint64_t cmd_id;
-    wait_cmd_info_t* index;
-
-    cmd_id = cmd->id();
-    index = new wait_cmd_info_t{this, cmd_id, cmd->get_cur_step()};
-    if (index == nullptr) {
-        LOG_ERROR("add wait cmd index failed! cmd id: %llu", cmd_id);
-        return false;
+    std::string key(format_str("d:%s:%s", node, sql));
+    if (join_flight(key, cmd)) {
+        return true;
     }
 
-    if (!m_db_pool->async_query(node, &on_mysql_lib_query_callback, sql, index)) {
-        SAFE_DELETE(index);
+    flight_t* flight = add_flight(key, cmd, {format_str("d:%s", node)});
+    if (!m_db_pool->async_query(node, &on_mysql_flight_lib_callback, sql, flight)) {
         LOG_ERROR("database query failed! node: %s, sql: %s", node, sql);
+        del_flight(flight);
         return false;
     }
 
     return true;
 }
 
+bool Network::join_flight(const std::string& key, Cmd* cmd) {
+    flight_t** flight = m_flights.find(key);
+    if (flight == nullptr) {
+        return false;
+    }
+    (*flight)->waiters.push_back({this, cmd->id(), cmd->get_cur_step()});
+    LOG_TRACE("join flight, cmd id: %llu, waiters: %lu", cmd->id(), (*flight)->waiters.size());
+    return true;
+}
+
+Network::flight_t* Network::add_flight(const std::string& key, Cmd* cmd,
+                                        std::vector<std::string>&& groups) {
+    flight_t* flight = new flight_t;
+    flight->net = this;
+    flight->key = key;
+    flight->waiters.push_back({this, cmd->id(), cmd->get_cur_step()});
+    flight->groups = std::move(groups);
+    m_flights.insert(key, flight);
+    for (const auto& group : flight->groups) {
+        m_flight_groups[group].push_back(flight);
+    }
+    return flight;
+}
+
+void Network::del_flight(flight_t* flight) {
+    unlink_flight(flight);
+    SAFE_DELETE(flight);
+}
+
+void Network::unlink_flight(flight_t* flight) {
+    /* a detached flight's key may belong to a new one. */
+    flight_t** f = m_flights.find(flight->key);
+    if (f != nullptr && *f == flight) {
+        m_flights.erase(flight->key);
+    }
+
+    for (const auto& group : flight->groups) {
+        auto it = m_flight_groups.find(group);
+        if (it == m_flight_groups.end()) {
+            continue;
+        }
+        auto& flights = it->second;
+        auto itr = std::find(flights.begin(), flights.end(), flight);
+        if (itr != flights.end()) {
+            flights.erase(itr);
+        }
+        if (flights.empty()) {
+            m_flight_groups.erase(it);
+        }
+    }
+}
+
+void Network::detach_flights(const std::string& group) {
+    auto it = m_flight_groups.find(group);
+    if (it == m_flight_groups.end()) {
+        return;
+    }
+
+    for (auto flight : it->second) {
+        flight_t** f = m_flights.find(flight->key);
+        if (f != nullptr && *f == flight) {
+            LOG_TRACE("detach flight, key: %s", flight->key.c_str());
+            m_flights.erase(flight->key);
+        }
+    }
+}
+
+void Network::on_redis_flight_lib_callback(redisAsyncContext* c, void* reply, void* privdata) {
+    flight_t* flight = static_cast<flight_t*>(privdata);
+    flight->net->on_redis_flight_callback(c, reply, flight);
+}
+
+void Network::on_redis_flight_callback(redisAsyncContext* c, void* reply, flight_t* flight) {
+    if (reply != nullptr && c->err != 0) {
+        LOG_ERROR("redis callback data: %s, err: %d, errstr: %s",
+                  ((redisReply*)reply)->str, c->err, c->errstr);
+    }
+
+    /* the cmds which send the same read in callback start a new flight. */
+    unlink_flight(flight);
+    for (auto& index : flight->waiters) {
+        handle_cmd_callback(&index, c->err, reply);
+    }
+    SAFE_DELETE(flight);
+}
+
+void Network::on_mysql_flight_lib_callback(const MysqlAsyncConn* c, sql_task_t* task, MysqlResult* res) {
+    flight_t* flight = static_cast<flight_t*>(task->privdata);
+    flight->net->on_mysql_flight_callback(c, task, res);
+}
+
+void Network::on_mysql_flight_callback(const MysqlAsyncConn* c, sql_task_t* task, MysqlResult* res) {
+    if (task->error != ERR_OK) {
+        LOG_ERROR("database query failed, error: %d, errstr: %s",
+                  task->error, task->errstr.c_str());
+    }
+
+    flight_t* flight = static_cast<flight_t*>(task->privdata);
+    unlink_flight(flight);
+    for (auto& index : flight->waiters) {
+        if (res != nullptr) {
+            res->rewind();
+        }
+        handle_cmd_callback(&index, task->error, res);
+    }
+    SAFE_DELETE(flight);
+}
+
 void Network::on_mysql_lib_query_callback(const MysqlAsyncConn* c, sql_task_t* task, MysqlResult* res) {
     wait_cmd_info_t* index = static_cast<wait_cmd_info_t*>(task->privdata);
     index->net->on_mysql_query_callback(c, task, res);
@@ -1421,6 +2186,7 @@ bool Network::handle_cmd_callback(wait_cmd_info_t* index, int err, void* data) {
     cmd->set_active_time(now());
     ret = cmd->on_callback(err, data);
     if (ret != Cmd::STATUS::RUNNING) {
+        check_http_response(cmd->req(), 500);
         del_cmd(cmd);
     }
 
@@ -1450,8 +2216,7 @@ bool Network::add_cmd(Cmd* cmd) {
         return false;
     }
 
-    auto it = m_cmds.insert({cmd->id(), cmd});
-    if (it.second == false) {
+    if (!m_cmds.insert(cmd->id(), cmd)) {
         LOG_ERROR("cmd: %s duplicate!", cmd->name());
         return false;
     }
@@ -1460,12 +2225,12 @@ bool Network::add_cmd(Cmd* cmd) {
 }
 
 Cmd* Network::get_cmd(uint64_t id) {
-    auto it = m_cmds.find(id);
-    if (it == m_cmds.end() || it->second == nullptr) {
+    Cmd** cmd = m_cmds.find(id);
+    if (cmd == nullptr || *cmd == nullptr) {
         LOG_WARN("find cmd failed! seq: %llu", id);
         return nullptr;
     }
-    return it->second;
+    return *cmd;
 }
 
 bool Network::del_cmd(Cmd* cmd) {
@@ -1475,19 +2240,17 @@ bool Network::del_cmd(Cmd* cmd) {
 
     LOG_TRACE("delete cmd id: %llu", cmd->id());
 
-    auto it = m_cmds.find(cmd->id());
-    if (it == m_cmds.end()) {
+    if (!m_cmds.erase(cmd->id())) {
         return false;
     }
 
-    m_cmds.erase(it);
     if (cmd->timer() != nullptr) {
         LOG_TRACE("del timer: %p!", cmd->timer());
         del_cmd_timer(cmd->timer());
         cmd->set_timer(nullptr);
     }
 
-    SAFE_DELETE(cmd);
+    Cmd::release(cmd);
     return true;
 }
 
@@ -1526,15 +2289,36 @@ bool Network::load_redis_mgr() {
 
 bool Network::load_worker_data_mgr() {
     m_worker_data_mgr = new WorkerDataMgr(m_logger);
-    return (m_worker_data_mgr != nullptr);
+    if (m_worker_data_mgr == nullptr) {
+        return false;
+    }
+
+    std::string dispatch = m_conf("worker_dispatch");
+    if (!dispatch.empty() && !m_worker_data_mgr->set_dispatch(dispatch)) {
+        LOG_ERROR("invalid worker_dispatch: %s", dispatch.c_str());
+        return false;
+    }
+
+    if (m_worker_data_mgr->dispatch() == WorkerDataMgr::DISPATCH::SESSION) {
+        if (!m_conf("session_route_key").empty()) {
+            m_session_route_key = m_conf("session_route_key");
+        }
+        if (m_is_reuse_port) {
+            LOG_WARN("session dispatch does not work in reuse port mode!");
+        }
+        LOG_DEBUG("session route key: %s", m_session_route_key.c_str());
+    }
+    LOG_DEBUG("worker dispatch: %s",
+              WorkerDataMgr::dispatch_name(m_worker_data_mgr->dispatch()));
+    return true;
 }
 
 bool Network::update_conn_state(int fd, Connection::STATE state) {
-    auto it = m_conns.find(fd);
-    if (it == m_conns.end()) {
+    Connection* c = m_conns.get(fd);
+    if (c == nullptr) {
         return false;
     }
-    it->second->set_state(state);
+    c->set_state(state);
     return true;
 }
 
@@ -1551,22 +2335,18 @@ bool Network::add_session(Session* s) {
     return m_session_mgr->add_session(s);
 }
 
-Session* Network::get_session(const std::string& sessid, bool re_active) {
+Session* Network::get_session(const StrView& sessid, bool re_active) {
     return m_session_mgr->get_session(sessid, re_active);
 }
 
-bool Network::del_session(const std::string& sessid) {
+bool Network::del_session(const StrView& sessid) {
     return m_session_mgr->del_session(sessid);
 }
 
-void Network::on_session_timer(void* privdata) {
-    m_session_mgr->on_session_timer(privdata);
-}
-
 bool Network::add_io_timer(Connection* c, double secs) {
     /* create timer. */
     LOG_TRACE("add io timer, fd: %d, time val: %f", c->fd(), secs);
-    ev_timer* w = m_events->add_io_timer(secs, c->timer(), c);
+    wheel_timer_t* w = m_events->add_io_timer(secs, c->timer(), c);
     if (w == nullptr) {
         LOG_ERROR("add timer failed! fd: %d", c->fd());
         close_conn(c);
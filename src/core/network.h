@@ -3,6 +3,8 @@
 
 #include <sys/socket.h>
 
+#include <deque>
+
 #include "connection.h"
 #include "db/db_mgr.h"
 #include "events.h"
@@ -10,11 +12,13 @@
 #include "module_mgr.h"
 #include "net/anet.h"
 #include "net/chanel.h"
+#include "net/shm_ring.h"
 #include "nodes.h"
 #include "protobuf/sys/payload.pb.h"
 #include "redis/redis_mgr.h"
 #include "session.h"
 #include "sys_cmd.h"
+#include "util/flat_map.h"
 #include "worker_data_mgr.h"
 #include "zk_client.h"
 
@@ -35,6 +39,38 @@ class Network : public EventsCallback, public INet {
         int count = 0;
     } chanel_resend_data_t;
 
+    /* ctrl chanel between manager and worker through shared memory,
+     * one ring for each direction, socketpair is still kept. */
+    typedef struct shm_chanel_s {
+        int ctrl_fd = -1;
+        ShmRing* send = nullptr;
+        ShmRing* recv = nullptr;
+        ev_io* w = nullptr; /* recv ring's eventfd. */
+        /* records wait for send ring's space, keeping the order. */
+        std::deque<std::string> wait_records;
+        bool is_notify_failed = false;
+    } shm_chanel_t;
+
+    /* session dispatch: manager peeks client's first request for its
+     * session id, then transfers the fd to the worker which owns it. */
+    typedef struct route_fd_s {
+        int fd = -1;
+        int family = 0;
+        double accept_time = 0;
+        ev_io* w = nullptr;
+        bool is_peek_waiting = false; /* read event stops, timer peeks again. */
+    } route_fd_t;
+
+    /* identical reads in flight share one request to redis or database,
+     * its reply is fanned out to every waiting cmd. a write detaches the
+     * flights of its node and keys, the later reads start new ones. */
+    typedef struct flight_s {
+        Network* net = nullptr;
+        std::string key;
+        std::vector<wait_cmd_info_t> waiters;
+        std::vector<std::string> groups; /* keys in m_flight_groups. */
+    } flight_t;
+
     Network(Log* logger, TYPE type);
     virtual ~Network();
 
@@ -60,7 +96,13 @@ class Network : public EventsCallback, public INet {
     void set_keep_alive(double secs) { m_keep_alive = secs; }
     double keep_alive() { return m_keep_alive; }
     bool is_request(int cmd) { return (cmd & 0x00000001); }
+    bool is_reuse_port() { return m_is_reuse_port; }
+    bool is_shm_chanel() { return m_is_shm_chanel; }
+    /* network owns the rings, when it returns true. */
+    bool add_shm_chanel(int ctrl_fd, ShmRing* send, ShmRing* recv);
     bool handle_cmd_callback(wait_cmd_info_t* index, int err, void* data);
+    /* answer the http request with status code, if it has no response. */
+    bool check_http_response(const Request* req, int status_code);
     Connection* get_conn(const fd_t& f);
     bool check_conn(int fd);
 
@@ -101,22 +143,22 @@ class Network : public EventsCallback, public INet {
 
     /* session */
     virtual bool add_session(Session* s) override;
-    virtual Session* get_session(const std::string& sessid, bool re_active = false) override;
-    virtual bool del_session(const std::string& sessid) override;
+    virtual Session* get_session(const StrView& sessid, bool re_active = false) override;
+    virtual bool del_session(const StrView& sessid) override;
+    virtual SessionMgr* session_mgr() override { return m_session_mgr; }
 
    public:
     /* cmd. */
     virtual bool add_cmd(Cmd* cmd) override;
     virtual Cmd* get_cmd(uint64_t id) override;
     virtual bool del_cmd(Cmd* cmd) override;
-    virtual ev_timer* add_cmd_timer(double secs, ev_timer* w, void* privdata) override;
-    virtual bool del_cmd_timer(ev_timer* w) override;
+    virtual wheel_timer_t* add_cmd_timer(double secs, wheel_timer_t* w, void* privdata) override;
+    virtual bool del_cmd_timer(wheel_timer_t* w) override;
 
     virtual void on_io_read(int fd) override;
     virtual void on_io_write(int fd) override;
     virtual void on_io_timer(void* privdata) override;
     virtual void on_cmd_timer(void* privdata) override;
-    virtual void on_session_timer(void* privdata) override;
     /* call by manager/worker. */
     virtual void on_repeat_timer(void* privdata) override;
 
@@ -148,6 +190,17 @@ class Network : public EventsCallback, public INet {
     virtual void on_mysql_query_callback(const MysqlAsyncConn* c, sql_task_t* task, MysqlResult* res) override;
 
    private:
+    /* single flight. */
+    bool join_flight(const std::string& key, Cmd* cmd);
+    flight_t* add_flight(const std::string& key, Cmd* cmd, std::vector<std::string>&& groups);
+    void del_flight(flight_t* flight);
+    void unlink_flight(flight_t* flight);
+    void detach_flights(const std::string& group);
+    void on_redis_flight_callback(redisAsyncContext* c, void* reply, flight_t* flight);
+    void on_mysql_flight_callback(const MysqlAsyncConn* c, sql_task_t* task, MysqlResult* res);
+    static void on_redis_flight_lib_callback(redisAsyncContext* c, void* reply, void* privdata);
+    static void on_mysql_flight_lib_callback(const MysqlAsyncConn* c, sql_task_t* task, MysqlResult* res);
+
     bool create_events();
     void close_fd(int fd);
     void check_wait_send_fds();
@@ -155,10 +208,21 @@ class Network : public EventsCallback, public INet {
     ev_io* add_write_event(Connection* c);
 
     /* socket. */
-    int listen_to_port(const char* host, int port);
+    int listen_to_port(const char* host, int port, bool reuse_port = false);
+    bool listen_to_gate(const char* host, int port);
     void accept_server_conn(int listen_fd);
+    void accept_gate_conn(int listen_fd);
     void accept_and_transfer_fd(int listen_fd);
+    void transfer_fds(int chanel_fd, std::vector<channel_t>& chs);
     void read_transfer_fd(int fd);
+    bool add_route_fd(int fd, int family);
+    void del_route_fd(int fd, bool is_close);
+    void route_fd(route_fd_t* r, bool is_timeout);
+    void check_route_fds();
+    void check_route_peeks();
+    static void on_route_peek_timer(struct ev_loop* loop, ev_timer* w, int revents);
+    bool is_peek_done(const char* data, size_t len);
+    bool peek_sessid(const char* data, size_t len, std::string& sessid);
     bool read_query_from_client(int fd);
     bool process_msg(Connection* c);
     bool process_tcp_msg(Connection* c);
@@ -173,6 +237,14 @@ class Network : public EventsCallback, public INet {
     bool close_conn(Connection* c);
     void close_conns();
 
+    /* shared memory ctrl chanel. */
+    void del_shm_chanel(int ctrl_fd);
+    void read_shm_chanel(shm_chanel_t* ch);
+    shm_chanel_t* get_shm_chanel(int ctrl_fd);
+    bool send_to_shm(shm_chanel_t* ch, const MsgHead& head, const MsgBody& body);
+    void flush_shm_chanel(shm_chanel_t* ch);
+    void flush_shm_chanels();
+
     /* timer */
     bool add_io_timer(Connection* c, double secs);
 
@@ -195,13 +267,24 @@ class Network : public EventsCallback, public INet {
 
     TYPE m_type = TYPE::UNKNOWN;                               /* owner type. */
     double m_keep_alive = IO_TIMEOUT_VAL;                      /* io timeout time. */
+    bool m_is_reuse_port = false;                              /* workers accept gate connections by themselves. */
+    bool m_is_shm_chanel = false;                              /* ctrl chanel uses shared memory ring. */
+    int m_pipeline_depth = HTTP_PIPELINE_DEPTH;                /* max http requests in processing per connection. */
     WorkerDataMgr* m_worker_data_mgr = nullptr;                /* manager handle worker data. */
     Codec::TYPE m_gate_codec = Codec::TYPE::UNKNOWN;           /* gate codec type. */
-    std::unordered_map<int, Connection*> m_conns;              /* key: fd, value: connection. */
+    FdTable<Connection> m_conns;                               /* index: fd, value: connection. */
     std::unordered_map<std::string, Connection*> m_node_conns; /* key: node_id */
 
-    std::unordered_map<uint64_t, Cmd*> m_cmds;        /* key: cmd id. */
+    FlatMap<uint64_t, Cmd*> m_cmds;                   /* key: cmd id. */
+    FlatMap<std::string, flight_t*> m_flights;        /* key: node and read cmd. */
+    /* key: "r:node", "r:node:arg" or "d:node", flights which a write detaches. */
+    std::unordered_map<std::string, std::vector<flight_t*>> m_flight_groups;
     std::list<chanel_resend_data_t*> m_wait_send_fds; /* sendmsg maybe return -1 and errno == EAGAIN. */
+    SegmentPool* m_segment_pool = nullptr;            /* socket buffer segments, shared by connections. */
+    FdTable<route_fd_t> m_route_fds;                  /* fds wait for session id to dispatch. */
+    ev_timer* m_route_peek_timer = nullptr;           /* peeks the incomplete first requests. */
+    std::string m_session_route_key = "sessid";       /* http param or header which carries session id. */
+    std::unordered_map<int, shm_chanel_t*> m_shm_chanels; /* key: recv ring's eventfd. */
 
     ModuleMgr* m_module_mgr = nullptr;   /* modules so. */
     DBMgr* m_db_pool = nullptr;          /* data base connection pool. */
@@ -0,0 +1,353 @@
+#include "redis_cache.h"
+
+namespace kim {
+
+/* keyspace channel of db 0, RedisMgr does not select db. */
+#define KEYSPACE_PREFIX "__keyspace@0__:"
+#define KEYSPACE_PREFIX_LEN (sizeof(KEYSPACE_PREFIX) - 1)
+
+RdsCache::RdsCache(Log* logger, struct ev_loop* loop, const std::string& host, int port,
+                   size_t max_bytes, double ttl)
+    : m_logger(logger), m_loop(loop), m_host(host), m_port(port), m_max_bytes(max_bytes), m_ttl(ttl) {
+    memset(&m_hit_ctx, 0, sizeof(m_hit_ctx));
+    m_hit_ctx.c.tcp.host = const_cast<char*>(m_host.c_str());
+    m_hit_ctx.c.tcp.port = m_port;
+    m_hit_ctx.errstr = m_hit_ctx.c.errstr;
+
+    ev_timer_init(&m_hit_timer, on_hit_libev_timer, 0, 0);
+    m_hit_timer.data = this;
+}
+
+RdsCache::~RdsCache() {
+    ev_timer_stop(m_loop, &m_hit_timer);
+    SAFE_DELETE(m_sub_conn);
+    clear();
+
+    /* the cached replies which are not called back yet. */
+    m_hit_ctx.err = REDIS_ERR;
+    snprintf(m_hit_ctx.c.errstr, sizeof(m_hit_ctx.c.errstr), "redis cache is closed!");
+    for (auto& h : m_hits) {
+        h->fn(&m_hit_ctx, nullptr, h->privdata);
+        SAFE_DELETE(h);
+    }
+    m_hits.clear();
+}
+
+bool RdsCache::is_read_cmd(const std::vector<std::string>& argv) {
+    return argv.size() == 2 && strcasecmp(argv[0].c_str(), "get") == 0;
+}
+
+bool RdsCache::subscribe() {
+    if (m_sub_conn == nullptr) {
+        m_sub_conn = new RdsConnection(m_logger, m_loop);
+    }
+    if (m_sub_conn->is_active()) {
+        return true;
+    }
+
+    /* the config's reply comes before the subscription's. */
+    m_is_notify_ok = false;
+    if (!m_sub_conn->connect(m_host, m_port) ||
+        !m_sub_conn->send_to({"config", "get", "notify-keyspace-events"},
+                             on_config_libev_callback, this) ||
+        !m_sub_conn->send_to({"psubscribe", KEYSPACE_PREFIX "*"}, on_sub_libev_callback, this)) {
+        LOG_ERROR("subscribe keyspace notifications failed! host: %s, port: %d",
+                  m_host.c_str(), m_port);
+        return false;
+    }
+    return true;
+}
+
+bool RdsCache::reply(const std::string& key, redisCallbackFn* fn, void* privdata) {
+    if (!m_is_subscribed) {
+        return false;
+    }
+
+    entry_t** it = m_entries.find(key);
+    if (it == nullptr) {
+        m_miss_cnt++;
+        return false;
+    }
+
+    entry_t* e = *it;
+    if (e->expire_time != 0 && e->expire_time <= ev_now(m_loop)) {
+        remove(e);
+        m_miss_cnt++;
+        return false;
+    }
+
+    /* the caller is not ready for the reply, it is called back in next loop. */
+    hit_t* h = new hit_t;
+    h->value = e->value;
+    h->fn = fn;
+    h->privdata = privdata;
+    m_hits.push_back(h);
+    if (!ev_is_active(&m_hit_timer)) {
+        ev_timer_start(m_loop, &m_hit_timer);
+    }
+
+    lru_touch(e);
+    m_hit_cnt++;
+    return true;
+}
+
+bool RdsCache::send_to(RdsConnection* c, const std::vector<std::string>& argv,
+                       redisCallbackFn* fn, void* privdata) {
+    if (!subscribe()) {
+        clear();
+    }
+
+    if (!is_read_cmd(argv)) {
+        /* the writer sees its own write, before notification comes. */
+        if (strncasecmp(argv[0].c_str(), "flush", 5) == 0) {
+            clear(); /* FLUSHDB, FLUSHALL, no keyspace notification for them. */
+        }
+        for (size_t i = 1; i < argv.size(); i++) {
+            del(argv[i]);
+        }
+        return c->send_to(argv, fn, privdata);
+    }
+
+    fill_t* fill = new fill_t;
+    fill->cache = this;
+    fill->key = argv[1];
+    fill->fn = fn;
+    fill->privdata = privdata;
+
+    if (!c->send_to(argv, on_fill_libev_callback, fill)) {
+        SAFE_DELETE(fill);
+        return false;
+    }
+
+    filling_t* f = m_fillings.find(fill->key);
+    if (f == nullptr) {
+        m_fillings.insert(fill->key, filling_t());
+        f = m_fillings.find(fill->key);
+    }
+    f->cnt++;
+    return true;
+}
+
+void RdsCache::on_fill_libev_callback(redisAsyncContext* c, void* reply, void* privdata) {
+    fill_t* fill = static_cast<fill_t*>(privdata);
+    fill->cache->on_fill_callback(c, static_cast<redisReply*>(reply), fill);
+}
+
+void RdsCache::on_fill_callback(redisAsyncContext* c, redisReply* r, fill_t* fill) {
+    bool stale = true;
+
+    filling_t* f = m_fillings.find(fill->key);
+    if (f != nullptr) {
+        stale = f->stale;
+        if (--f->cnt <= 0) {
+            m_fillings.erase(fill->key);
+        }
+    }
+
+    if (!stale && m_is_subscribed && r != nullptr && r->type == REDIS_REPLY_STRING) {
+        set(fill->key, r->str, r->len);
+    }
+
+    fill->fn(c, r, fill->privdata);
+    SAFE_DELETE(fill);
+}
+
+void RdsCache::on_hit_libev_timer(struct ev_loop* loop, ev_timer* w, int revents) {
+    RdsCache* cache = static_cast<RdsCache*>(w->data);
+    cache->on_hit_timer();
+}
+
+void RdsCache::on_hit_timer() {
+    redisReply r;
+    std::vector<hit_t*> hits;
+
+    /* callbacks may hit the cache again. */
+    hits.swap(m_hits);
+    for (auto& h : hits) {
+        memset(&r, 0, sizeof(r));
+        r.type = REDIS_REPLY_STRING;
+        r.str = &h->value[0];
+        r.len = h->value.length();
+        h->fn(&m_hit_ctx, &r, h->privdata);
+        SAFE_DELETE(h);
+    }
+}
+
+void RdsCache::on_sub_libev_callback(redisAsyncContext* c, void* reply, void* privdata) {
+    RdsCache* cache = static_cast<RdsCache*>(privdata);
+    cache->on_sub_callback(c, static_cast<redisReply*>(reply));
+}
+
+void RdsCache::on_config_libev_callback(redisAsyncContext* c, void* reply, void* privdata) {
+    RdsCache* cache = static_cast<RdsCache*>(privdata);
+    cache->on_config_callback(c, static_cast<redisReply*>(reply));
+}
+
+/* ["notify-keyspace-events", flags], keyspace events ("K") of
+ * generic ("g") and string ("$") cmds, or all ("A"). */
+void RdsCache::on_config_callback(redisAsyncContext* c, redisReply* r) {
+    if (r == nullptr || r->type != REDIS_REPLY_ARRAY || r->elements < 2 ||
+        r->element[1]->type != REDIS_REPLY_STRING) {
+        LOG_WARN("get redis notify-keyspace-events failed! host: %s, port: %d",
+                 m_host.c_str(), m_port);
+        m_is_notify_ok = false;
+        return;
+    }
+
+    const char* flags = r->element[1]->str;
+    m_is_notify_ok = (strchr(flags, 'K') != nullptr) &&
+                     (strchr(flags, 'A') != nullptr ||
+                      (strchr(flags, 'g') != nullptr && strchr(flags, '$') != nullptr));
+    if (!m_is_notify_ok) {
+        LOG_WARN("redis notify-keyspace-events: \"%s\", it needs \"KA\"! host: %s, port: %d",
+                 flags, m_host.c_str(), m_port);
+    }
+}
+
+void RdsCache::on_sub_callback(redisAsyncContext* c, redisReply* r) {
+    if (r == nullptr || r->type != REDIS_REPLY_ARRAY || r->elements < 3) {
+        if (m_is_subscribed) {
+            LOG_ERROR("keyspace subscription is broken! host: %s, port: %d",
+                      m_host.c_str(), m_port);
+        }
+        /* notifications may be lost. */
+        m_is_subscribed = false;
+        clear();
+        return;
+    }
+
+    /* ["psubscribe", pattern, cnt] or ["pmessage", pattern, channel, event]. */
+    redisReply* type = r->element[0];
+    if (type->type != REDIS_REPLY_STRING) {
+        return;
+    }
+
+    if (strcasecmp(type->str, "psubscribe") == 0) {
+        if (!m_is_notify_ok) {
+            /* entries would never be invalidated by other processes' writes. */
+            LOG_WARN("keyspace events are not notified, redis cache is off! host: %s, port: %d",
+                     m_host.c_str(), m_port);
+            return;
+        }
+        LOG_INFO("keyspace subscribed! host: %s, port: %d", m_host.c_str(), m_port);
+        m_is_subscribed = true;
+        /* the fills sent before it may miss the notifications. */
+        for (auto& it : m_fillings) {
+            it.second.stale = true;
+        }
+        return;
+    }
+
+    if (r->elements < 4 || strcasecmp(type->str, "pmessage") != 0) {
+        return;
+    }
+
+    redisReply* channel = r->element[2];
+    if (channel->len > KEYSPACE_PREFIX_LEN) {
+        del(StrView(channel->str + KEYSPACE_PREFIX_LEN, channel->len - KEYSPACE_PREFIX_LEN));
+    }
+}
+
+void RdsCache::set(const std::string& key, const char* value, size_t len) {
+    entry_t* e;
+    size_t size = sizeof(entry_t) + key.length() + len;
+
+    if (m_max_bytes > 0 && size > m_max_bytes) {
+        del(key);
+        return;
+    }
+
+    entry_t** it = m_entries.find(key);
+    if (it != nullptr) {
+        e = *it;
+        lru_touch(e);
+    } else {
+        e = new entry_t;
+        e->key = key;
+        m_entries.insert(key, e);
+        lru_add(e);
+    }
+
+    e->value.assign(value, len);
+    e->expire_time = (m_ttl > 0) ? ev_now(m_loop) + m_ttl : 0;
+    m_bytes = m_bytes - e->mem_size + size;
+    e->mem_size = size;
+    evict();
+}
+
+void RdsCache::del(const StrView& key) {
+    filling_t* f = m_fillings.find(key);
+    if (f != nullptr) {
+        f->stale = true;
+    }
+
+    entry_t** it = m_entries.find(key);
+    if (it != nullptr) {
+        remove(*it);
+        m_invalidate_cnt++;
+    }
+}
+
+void RdsCache::clear() {
+    entry_t *e, *next;
+    for (e = m_lru_head; e != nullptr; e = next) {
+        next = e->next;
+        SAFE_DELETE(e);
+    }
+    m_lru_head = m_lru_tail = nullptr;
+    m_entries.clear();
+    m_bytes = 0;
+
+    for (auto& it : m_fillings) {
+        it.second.stale = true;
+    }
+}
+
+void RdsCache::remove(entry_t* e) {
+    lru_del(e);
+    m_entries.erase(e->key);
+    m_bytes -= e->mem_size;
+    SAFE_DELETE(e);
+}
+
+void RdsCache::evict() {
+    while (m_max_bytes > 0 && m_bytes > m_max_bytes && m_lru_tail != nullptr) {
+        remove(m_lru_tail);
+        m_evict_cnt++;
+    }
+}
+
+void RdsCache::lru_add(entry_t* e) {
+    e->prev = nullptr;
+    e->next = m_lru_head;
+    if (m_lru_head != nullptr) {
+        m_lru_head->prev = e;
+    }
+    m_lru_head = e;
+    if (m_lru_tail == nullptr) {
+        m_lru_tail = e;
+    }
+}
+
+void RdsCache::lru_del(entry_t* e) {
+    if (e->prev != nullptr) {
+        e->prev->next = e->next;
+    } else {
+        m_lru_head = e->next;
+    }
+    if (e->next != nullptr) {
+        e->next->prev = e->prev;
+    } else {
+        m_lru_tail = e->prev;
+    }
+    e->prev = e->next = nullptr;
+}
+
+void RdsCache::lru_touch(entry_t* e) {
+    if (m_lru_head != e) {
+        lru_del(e);
+        lru_add(e);
+    }
+}
+
+}  // namespace kim
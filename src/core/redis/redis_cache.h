@@ -0,0 +1,123 @@
+#ifndef __KIM_REDIS_CACHE_H__
+#define __KIM_REDIS_CACHE_H__
+
+#include "redis_context.h"
+#include "util/flat_map.h"
+
+namespace kim {
+
+/* per worker read-through cache of redis GET, in front of a redis node.
+ * entries are linked in a lru list, the least recently read ones are
+ * evicted when the memory budget is exceeded, and they expire by ttl.
+ * entries are invalidated by keyspace notifications, the server should
+ * be configured with "notify-keyspace-events KA". the cache is not used
+ * until the subscription is ok and the server's config is checked,
+ * and it is cleared when the subscription is broken. */
+class RdsCache {
+   public:
+    typedef struct entry_s {
+        std::string key;
+        std::string value;
+        double expire_time = 0; /* 0: no ttl. */
+        size_t mem_size = 0;
+        struct entry_s* prev = nullptr;
+        struct entry_s* next = nullptr;
+    } entry_t;
+
+    /* the GET which is sent to fill the cache. */
+    typedef struct fill_s {
+        RdsCache* cache = nullptr;
+        std::string key;
+        redisCallbackFn* fn = nullptr;
+        void* privdata = nullptr;
+    } fill_t;
+
+    /* in flight fills of a key, stale: key is changed before the reply. */
+    typedef struct filling_s {
+        int cnt = 0;
+        bool stale = false;
+    } filling_t;
+
+    /* cached reply which is called back in the next loop. */
+    typedef struct hit_s {
+        std::string value;
+        redisCallbackFn* fn = nullptr;
+        void* privdata = nullptr;
+    } hit_t;
+
+    RdsCache(Log* logger, struct ev_loop* loop, const std::string& host, int port,
+             size_t max_bytes, double ttl);
+    virtual ~RdsCache();
+
+    RdsCache(const RdsCache&) = delete;
+    RdsCache& operator=(const RdsCache&) = delete;
+
+    /* "GET key". */
+    static bool is_read_cmd(const std::vector<std::string>& argv);
+
+    /* true: hit, fn is called back in the next loop. */
+    bool reply(const std::string& key, redisCallbackFn* fn, void* privdata);
+    /* send cmd by c, GET fills the cache, others invalidate their keys. */
+    bool send_to(RdsConnection* c, const std::vector<std::string>& argv, redisCallbackFn* fn, void* privdata);
+
+    void del(const StrView& key);
+    void clear();
+
+    /* stats. */
+    size_t size() const { return m_entries.size(); }
+    size_t bytes() const { return m_bytes; }
+    uint64_t hit_cnt() const { return m_hit_cnt; }
+    uint64_t miss_cnt() const { return m_miss_cnt; }
+    uint64_t evict_cnt() const { return m_evict_cnt; }
+    uint64_t invalidate_cnt() const { return m_invalidate_cnt; }
+
+   private:
+    bool subscribe();
+    void set(const std::string& key, const char* value, size_t len);
+    void remove(entry_t* e);
+    void evict();
+
+    void lru_add(entry_t* e);
+    void lru_del(entry_t* e);
+    void lru_touch(entry_t* e);
+
+    void on_fill_callback(redisAsyncContext* c, redisReply* r, fill_t* fill);
+    void on_sub_callback(redisAsyncContext* c, redisReply* r);
+    void on_config_callback(redisAsyncContext* c, redisReply* r);
+    void on_hit_timer();
+    static void on_fill_libev_callback(redisAsyncContext* c, void* reply, void* privdata);
+    static void on_sub_libev_callback(redisAsyncContext* c, void* reply, void* privdata);
+    static void on_config_libev_callback(redisAsyncContext* c, void* reply, void* privdata);
+    static void on_hit_libev_timer(struct ev_loop* loop, ev_timer* w, int revents);
+
+   private:
+    Log* m_logger = nullptr;
+    struct ev_loop* m_loop = nullptr;
+    std::string m_host;
+    int m_port = 0;
+    size_t m_max_bytes = 0;
+    double m_ttl = 0;
+
+    RdsConnection* m_sub_conn = nullptr; /* keyspace notifications. */
+    bool m_is_subscribed = false;
+    bool m_is_notify_ok = false; /* server notifies the keyspace events of GET's keys. */
+
+    FlatMap<std::string, entry_t*> m_entries;
+    FlatMap<std::string, filling_t> m_fillings;
+    entry_t* m_lru_head = nullptr; /* most recently read. */
+    entry_t* m_lru_tail = nullptr; /* least recently read. */
+    size_t m_bytes = 0;
+
+    std::vector<hit_t*> m_hits;    /* wait for hit timer. */
+    ev_timer m_hit_timer;
+    redisAsyncContext m_hit_ctx;   /* context of cached replies. */
+
+    uint64_t m_hit_cnt = 0;
+    uint64_t m_miss_cnt = 0;
+    uint64_t m_evict_cnt = 0;
+    uint64_t m_invalidate_cnt = 0;
+};
+
+}  // namespace kim
+
+#endif  //__KIM_REDIS_CACHE_H__
@@ -0,0 +1,339 @@
+#include "redis_cluster.h"
+
+#include "util/util.h"
+
+namespace kim {
+
+RedisCluster::RedisCluster(Log* logger, struct ev_loop* loop, int conn_cnt, size_t max_wait_bytes)
+    : m_logger(logger), m_loop(loop), m_conn_cnt(conn_cnt), m_max_wait_bytes(max_wait_bytes) {
+    m_slots.resize(SLOT_CNT, -1);
+}
+
+RedisCluster::~RedisCluster() {
+    /* the cmds in flight are called back with null reply. */
+    m_is_closing = true;
+    for (auto& it : m_pools) {
+        SAFE_DELETE(it.second);
+    }
+    m_pools.clear();
+}
+
+/* crc16 xmodem, the same as redis cluster's. */
+static uint16_t crc16(const char* buf, size_t len) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)((uint8_t)buf[i] << 8);
+        for (int j = 0; j < 8; j++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+uint16_t RedisCluster::key_slot(const char* key, size_t len) {
+    size_t s, e;
+
+    /* only the part in the first "{...}" is hashed, if it is not empty. */
+    for (s = 0; s < len; s++) {
+        if (key[s] == '{') break;
+    }
+    if (s < len) {
+        for (e = s + 1; e < len; e++) {
+            if (key[e] == '}') break;
+        }
+        if (e < len && e != s + 1) {
+            return crc16(key + s + 1, e - s - 1) & (SLOT_CNT - 1);
+        }
+    }
+    return crc16(key, len) & (SLOT_CNT - 1);
+}
+
+int RedisCluster::key_index(const std::vector<std::string>& argv) {
+    if (argv.size() < 2) {
+        return -1;
+    }
+
+    /* EVAL script numkeys key [key ...] arg [arg ...] */
+    if (strcasecmp(argv[0].c_str(), "eval") == 0 ||
+        strcasecmp(argv[0].c_str(), "evalsha") == 0) {
+        return (argv.size() > 3 && str_to_int(argv[2]) > 0) ? 3 : -1;
+    }
+    return 1;
+}
+
+bool RedisCluster::add_seed(const std::string& host, int port) {
+    if (host.empty() || port <= 0) {
+        return false;
+    }
+    m_seeds.push_back(format_str("%s:%d", host.c_str(), port));
+    return true;
+}
+
+void RedisCluster::get_stats(RedisStats* stats) {
+    for (auto& it : m_pools) {
+        it.second->get_stats(stats);
+    }
+}
+
+int RedisCluster::get_addr_index(const std::string& addr) {
+    for (size_t i = 0; i < m_addrs.size(); i++) {
+        if (m_addrs[i] == addr) {
+            return i;
+        }
+    }
+    m_addrs.push_back(addr);
+    return m_addrs.size() - 1;
+}
+
+std::string RedisCluster::get_addr(int slot) {
+    int index = (slot >= 0 && slot < SLOT_CNT) ? m_slots[slot] : -1;
+    if (index >= 0) {
+        return m_addrs[index];
+    }
+
+    /* unknown slot, the node which is asked will redirect the cmd. */
+    if (!m_addrs.empty()) {
+        return m_addrs[0];
+    }
+    return m_seeds.empty() ? "" : m_seeds[0];
+}
+
+RdsConnection* RedisCluster::get_conn(const std::string& addr) {
+    RdsConnPool* pool;
+
+    auto it = m_pools.find(addr);
+    if (it != m_pools.end()) {
+        pool = it->second;
+    } else {
+        size_t pos = addr.rfind(':');
+        if (pos == std::string::npos || pos == 0) {
+            LOG_ERROR("invalid redis cluster addr: %s", addr.c_str());
+            return nullptr;
+        }
+        pool = new RdsConnPool(m_logger, m_loop, addr.substr(0, pos),
+                               str_to_int(addr.substr(pos + 1)), m_conn_cnt, m_max_wait_bytes);
+        m_pools[addr] = pool;
+    }
+    return pool->get_conn();
+}
+
+bool RedisCluster::send_to(const std::vector<std::string>& argv, redisCallbackFn* fn, void* privdata) {
+    int slot = -1;
+    std::string addr;
+
+    if (argv.size() == 0 || fn == nullptr) {
+        LOG_ERROR("invalid params!");
+        return false;
+    }
+
+    int index = key_index(argv);
+    if (index >= 0) {
+        slot = key_slot(argv[index].c_str(), argv[index].length());
+    }
+
+    if (slot < 0 || m_slots[slot] < 0) {
+        refresh_slots();
+    }
+
+    addr = get_addr(slot);
+    if (addr.empty()) {
+        LOG_ERROR("no redis cluster node!");
+        return false;
+    }
+
+    task_t* task = new task_t;
+    task->cluster = this;
+    task->argv = argv;
+    task->fn = fn;
+    task->privdata = privdata;
+
+    if (!send_task(task, addr, false)) {
+        SAFE_DELETE(task);
+        return false;
+    }
+    return true;
+}
+
+bool RedisCluster::send_task(task_t* task, const std::string& addr, bool is_asking) {
+    RdsConnection* c = get_conn(addr);
+    if (c == nullptr) {
+        LOG_ERROR("get redis cluster conn failed! addr: %s", addr.c_str());
+        return false;
+    }
+
+    /* ASK: the next cmd on the same connection is served by the importing node. */
+    if (is_asking && !c->send_to({"ASKING"}, on_asking_libev_callback, nullptr)) {
+        LOG_ERROR("send asking failed! addr: %s", addr.c_str());
+        return false;
+    }
+
+    if (!c->send_to(task->argv, on_task_libev_callback, task)) {
+        LOG_ERROR("send to redis cluster failed! addr: %s", addr.c_str());
+        return false;
+    }
+    return true;
+}
+
+void RedisCluster::refresh_slots() {
+    std::string addr;
+    double now = Clock::now(); /* monotonic, not stepped with wall clock. */
+
+    if (m_is_closing || m_is_refreshing || now - m_last_refresh < MIN_REFRESH_INTERVAL) {
+        return;
+    }
+
+    /* ask the known masters and seeds in turn, some of them may be down. */
+    size_t cnt = m_addrs.size() + m_seeds.size();
+    if (cnt == 0) {
+        return;
+    }
+    size_t i = (m_refresh_index++) % cnt;
+    addr = (i < m_addrs.size()) ? m_addrs[i] : m_seeds[i - m_addrs.size()];
+    m_last_refresh = now;
+
+    RdsConnection* c = get_conn(addr);
+    if (c == nullptr || !c->send_to({"CLUSTER", "SLOTS"}, on_slots_libev_callback, this)) {
+        LOG_ERROR("load redis cluster slots failed! addr: %s", addr.c_str());
+        return;
+    }
+    m_is_refreshing = true;
+}
+
+bool RedisCluster::parse_redirect(const redisReply* r, bool& is_ask, int& slot, std::string& addr) {
+    /* "MOVED 3999 127.0.0.1:6381" or "ASK 3999 127.0.0.1:6381". */
+    if (r == nullptr || r->type != REDIS_REPLY_ERROR || r->str == nullptr) {
+        return false;
+    }
+
+    std::string s(r->str, r->len);
+    if (strncmp(s.c_str(), "MOVED ", 6) == 0) {
+        is_ask = false;
+    } else if (strncmp(s.c_str(), "ASK ", 4) == 0) {
+        is_ask = true;
+    } else {
+        return false;
+    }
+
+    size_t pos = s.find(' ');
+    size_t pos2 = s.find(' ', pos + 1);
+    if (pos2 == std::string::npos) {
+        return false;
+    }
+
+    slot = str_to_int(s.substr(pos + 1, pos2 - pos - 1));
+    addr = s.substr(pos2 + 1);
+    return (slot >= 0 && slot < SLOT_CNT && !addr.empty());
+}
+
+void RedisCluster::error_callback(redisAsyncContext* c, task_t* task, const char* errstr) {
+    int old_error = c->err;
+    char* old_errstr = c->errstr;
+
+    if (c->err == REDIS_OK) {
+        c->err = REDIS_ERR;
+    }
+    if (c->errstr == nullptr) {
+        c->errstr = const_cast<char*>(errstr);
+    }
+    task->fn(c, nullptr, task->privdata);
+    c->err = old_error;
+    c->errstr = old_errstr;
+}
+
+void RedisCluster::on_task_callback(redisAsyncContext* c, redisReply* r, task_t* task) {
+    int slot;
+    bool is_ask;
+    std::string addr;
+
+    if (r == nullptr) {
+        /* connection is broken, the node may be failed over. */
+        task->fn(c, nullptr, task->privdata);
+        SAFE_DELETE(task);
+        refresh_slots();
+        return;
+    }
+
+    if (!parse_redirect(r, is_ask, slot, addr) || task->redirect_cnt >= MAX_REDIRECT_CNT) {
+        task->fn(c, r, task->privdata);
+        SAFE_DELETE(task);
+        return;
+    }
+
+    /* ":6381", the same host as the current node. */
+    if (addr[0] == ':') {
+        addr = c->c.tcp.host + addr;
+    }
+
+    LOG_DEBUG("redis cluster redirect: %s, slot: %d, addr: %s",
+              is_ask ? "ask" : "moved", slot, addr.c_str());
+
+    task->redirect_cnt++;
+    if (!is_ask) {
+        /* the slot is migrated, others may be moved too. */
+        m_slots[slot] = get_addr_index(addr);
+        refresh_slots();
+    }
+
+    if (!send_task(task, addr, is_ask)) {
+        error_callback(c, task, "redis cluster redirect failed!");
+        SAFE_DELETE(task);
+    }
+}
+
+void RedisCluster::on_slots_callback(redisAsyncContext* c, redisReply* r) {
+    int index;
+    long long start, end;
+    std::string host;
+
+    m_is_refreshing = false;
+    if (r == nullptr || r->type != REDIS_REPLY_ARRAY) {
+        LOG_ERROR("load redis cluster slots failed! err: %d, errstr: %s",
+                  c->err, (r != nullptr && r->str != nullptr) ? r->str : c->errstr);
+        return;
+    }
+
+    /* [[start, end, [host, port, id], [replica] ...], ...] */
+    std::vector<int> slots(SLOT_CNT, -1);
+    for (size_t i = 0; i < r->elements; i++) {
+        redisReply* e = r->element[i];
+        if (e->type != REDIS_REPLY_ARRAY || e->elements < 3 ||
+            e->element[2]->type != REDIS_REPLY_ARRAY || e->element[2]->elements < 2) {
+            continue;
+        }
+
+        start = e->element[0]->integer;
+        end = e->element[1]->integer;
+        if (start < 0 || start > end || end >= SLOT_CNT) {
+            continue;
+        }
+
+        redisReply* master = e->element[2];
+        host = (master->element[0]->len > 0) ? master->element[0]->str : c->c.tcp.host;
+        index = get_addr_index(format_str("%s:%lld", host.c_str(), master->element[1]->integer));
+        for (long long j = start; j <= end; j++) {
+            slots[j] = index;
+        }
+        LOG_DEBUG("redis cluster slots: %lld-%lld, addr: %s",
+                  start, end, m_addrs[index].c_str());
+    }
+    m_slots.swap(slots);
+}
+
+void RedisCluster::on_task_libev_callback(redisAsyncContext* c, void* reply, void* privdata) {
+    task_t* task = static_cast<task_t*>(privdata);
+    if (task->cluster->m_is_closing) {
+        task->fn(c, nullptr, task->privdata);
+        SAFE_DELETE(task);
+        return;
+    }
+    task->cluster->on_task_callback(c, static_cast<redisReply*>(reply), task);
+}
+
+void RedisCluster::on_slots_libev_callback(redisAsyncContext* c, void* reply, void* privdata) {
+    RedisCluster* cluster = static_cast<RedisCluster*>(privdata);
+    if (!cluster->m_is_closing) {
+        cluster->on_slots_callback(c, static_cast<redisReply*>(reply));
+    }
+}
+
+}  // namespace kim
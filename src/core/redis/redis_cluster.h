@@ -0,0 +1,80 @@
+#ifndef __KIM_REDIS_CLUSTER_H__
+#define __KIM_REDIS_CLUSTER_H__
+
+#include "redis_context.h"
+
+namespace kim {
+
+/* redis cluster client, keys are routed to the master which owns their
+ * hash slot, slot map is loaded by "CLUSTER SLOTS" and refreshed when
+ * MOVED is replied, MOVED and ASK are followed before callback. */
+class RedisCluster {
+   public:
+    enum {
+        SLOT_CNT = 16384,
+        MAX_REDIRECT_CNT = 5,
+        MIN_REFRESH_INTERVAL = 1, /* seconds between two "CLUSTER SLOTS". */
+    };
+
+    RedisCluster(Log* logger, struct ev_loop* loop, int conn_cnt = 1,
+                 size_t max_wait_bytes = RdsConnection::DEFAULT_MAX_WAIT_BYTES);
+    virtual ~RedisCluster();
+
+    RedisCluster(const RedisCluster&) = delete;
+    RedisCluster& operator=(const RedisCluster&) = delete;
+
+    /* seed node for loading slot map. */
+    bool add_seed(const std::string& host, int port);
+    bool send_to(const std::vector<std::string>& argv, redisCallbackFn* fn, void* privdata);
+    void get_stats(RedisStats* stats);
+
+    /* crc16 of key or its hash tag "{...}", mod SLOT_CNT. */
+    static uint16_t key_slot(const char* key, size_t len);
+    /* -1: cmd has no key. */
+    static int key_index(const std::vector<std::string>& argv);
+
+   private:
+    /* the user's cmd, kept for redirection. */
+    typedef struct task_s {
+        RedisCluster* cluster = nullptr;
+        std::vector<std::string> argv;
+        redisCallbackFn* fn = nullptr;
+        void* privdata = nullptr;
+        int redirect_cnt = 0;
+    } task_t;
+
+    RdsConnection* get_conn(const std::string& addr);
+    int get_addr_index(const std::string& addr);
+    std::string get_addr(int slot); /* "": slot is unknown. */
+    bool send_task(task_t* task, const std::string& addr, bool is_asking);
+
+    void refresh_slots();
+    bool parse_redirect(const redisReply* r, bool& is_ask, int& slot, std::string& addr);
+    void error_callback(redisAsyncContext* c, task_t* task, const char* errstr);
+
+    void on_task_callback(redisAsyncContext* c, redisReply* r, task_t* task);
+    void on_slots_callback(redisAsyncContext* c, redisReply* r);
+    static void on_task_libev_callback(redisAsyncContext* c, void* reply, void* privdata);
+    static void on_slots_libev_callback(redisAsyncContext* c, void* reply, void* privdata);
+    static void on_asking_libev_callback(redisAsyncContext* c, void* reply, void* privdata) {}
+
+   private:
+    Log* m_logger = nullptr;
+    struct ev_loop* m_loop = nullptr;
+    int m_conn_cnt = 1;
+    size_t m_max_wait_bytes = 0;
+
+    std::vector<std::string> m_seeds; /* "host:port". */
+    std::vector<std::string> m_addrs; /* master addrs, index is kept. */
+    std::vector<int> m_slots;         /* slot -> index of m_addrs, -1: unknown. */
+    std::unordered_map<std::string, RdsConnPool*> m_pools; /* key: addr. */
+
+    bool m_is_closing = false;
+    bool m_is_refreshing = false;  /* "CLUSTER SLOTS" is in flight. */
+    double m_last_refresh = 0;     /* monotonic time of the last refresh. */
+    size_t m_refresh_index = 0;    /* the next addr to load slot map from. */
+};
+
+}  // namespace kim
+
+#endif  //__KIM_REDIS_CLUSTER_H__
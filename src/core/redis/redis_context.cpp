@@ -3,6 +3,8 @@
 #include <hiredis/adapters/libev.h>
 #include <hiredis/hiredis.h>
 
+#include <algorithm>
+
 #include "error.h"
 
 namespace kim {
@@ -13,6 +15,10 @@ RdsConnection::RdsConnection(Log* logger, struct ev_loop* loop)
 
 RdsConnection::~RdsConnection() {
     destory();
+    for (auto r : m_free_replies) {
+        delete r;
+    }
+    m_free_replies.clear();
 }
 
 void RdsConnection::destory() {
@@ -23,9 +29,13 @@ void RdsConnection::destory() {
             wait_task_error_callback(m_ctx, task, REDIS_ERR, errstr);
             SAFE_DELETE(task);
         }
-        redisAsyncDisconnect(m_ctx);
+        /* the replies in flight are called back with null reply in it,
+         * no callback comes after the connection is gone. */
+        m_ctx->data = nullptr;
+        redisAsyncFree(m_ctx);
     }
     m_wait_tasks.clear();
+    m_wait_bytes = 0;
     set_state(STATE::CLOSED);
     m_ctx = nullptr;
 }
@@ -38,9 +48,12 @@ bool RdsConnection::connect(const std::string& host, int port) {
 
     destory();
 
+    m_host = host;
+    m_port = port;
+
     redisAsyncContext* c = redisAsyncConnect(host.c_str(), port);
     if (c == nullptr || c->err != REDIS_OK) {
-        if (c->err != REDIS_OK) {
+        if (c != nullptr) {
             LOG_ERROR("async connect rdis failed! host: %s, port: %d, error: %d, errstr: %s",
                       host.c_str(), port, c->err, c->errstr);
             redisAsyncFree(c);
@@ -48,6 +61,7 @@ bool RdsConnection::connect(const std::string& host, int port) {
             LOG_ERROR("async connect redis failed! host: %s, port: %d",
                       host.c_str(), port);
         }
+        on_connect_failed();
         return false;
     }
 
@@ -62,22 +76,58 @@ bool RdsConnection::connect(const std::string& host, int port) {
     redisAsyncSetDisconnectCallback(c, on_redis_disconnect_libev_callback);
     set_state(STATE::CONNECTING);
     m_ctx = c;
+    if (m_breaker == BREAKER::OPEN) {
+        m_breaker = BREAKER::HALF_OPEN;
+    }
     return true;
 }
 
+bool RdsConnection::can_connect() {
+    return m_breaker != BREAKER::OPEN || ev_now(m_loop) >= m_retry_time;
+}
+
+void RdsConnection::on_connect_failed() {
+    int shift = (m_fail_cnt < 16) ? m_fail_cnt : 16;
+    long long ms = std::min((long long)MIN_RETRY_INTERVAL_MS << shift, (long long)MAX_RETRY_INTERVAL_MS);
+
+    m_fail_cnt++;
+    m_connect_fail_cnt++;
+    m_breaker = BREAKER::OPEN;
+    m_retry_time = ev_now(m_loop) + ms / 1000.0;
+    LOG_WARN("redis breaker is open! host: %s, port: %d, fail cnt: %d, retry after: %lldms",
+             m_host.c_str(), m_port, m_fail_cnt, ms);
+}
+
+void RdsConnection::get_stats(RedisStats* stats) {
+    stats->set_wait_cnt(stats->wait_cnt() + m_wait_tasks.size());
+    stats->set_wait_bytes(stats->wait_bytes() + m_wait_bytes);
+    stats->set_pending_cnt(stats->pending_cnt() + m_pending_cnt);
+    stats->set_connect_fail_cnt(stats->connect_fail_cnt() + m_connect_fail_cnt);
+    stats->set_reject_cnt(stats->reject_cnt() + m_reject_cnt);
+    if (is_breaker_open()) {
+        stats->set_open_cnt(stats->open_cnt() + 1);
+    }
+}
+
 void RdsConnection::on_redis_connect_libev_callback(const redisAsyncContext* ac, int status) {
     RdsConnection* c = static_cast<RdsConnection*>(ac->data);
-    c->on_redis_connect_callback(ac, status);
+    if (c != nullptr) {
+        c->on_redis_connect_callback(ac, status);
+    }
 }
 
 void RdsConnection::on_redis_disconnect_libev_callback(const redisAsyncContext* ac, int status) {
     RdsConnection* c = static_cast<RdsConnection*>(ac->data);
-    c->on_redis_connect_callback(ac, status);
+    if (c != nullptr) {
+        c->on_redis_disconnect_callback(ac, status);
+    }
 }
 
 void RdsConnection::on_redis_connect_callback(const redisAsyncContext* ac, int status) {
     if (status == REDIS_OK) {
         set_state(STATE::CONNECTED);
+        m_breaker = BREAKER::CLOSED;
+        m_fail_cnt = 0;
         LOG_INFO("redis connected!, host: %s, port: %d",
                  ac->c.tcp.host, ac->c.tcp.port);
     } else {
@@ -86,6 +136,7 @@ void RdsConnection::on_redis_connect_callback(const redisAsyncContext* ac, int s
         set_state(STATE::CLOSED);
         LOG_ERROR("redis connect failed!, host: %s, port: %d",
                   ac->c.tcp.host, ac->c.tcp.port);
+        on_connect_failed();
     }
 
     char send_errstr[64] = {"send to redis failed!"};
@@ -95,7 +146,7 @@ void RdsConnection::on_redis_connect_callback(const redisAsyncContext* ac, int s
     for (auto& it : m_wait_tasks) {
         task_t* task = it;
         if (status == REDIS_OK) {
-            if (!send_to(task->argv, task->fn, task->privdata)) {
+            if (!send_cmd(task->argv, task->fn, task->privdata)) {
                 wait_task_error_callback(ac, task, REDIS_ERR, send_errstr);
             }
         } else {
@@ -104,12 +155,16 @@ void RdsConnection::on_redis_connect_callback(const redisAsyncContext* ac, int s
         SAFE_DELETE(it);
     }
     m_wait_tasks.clear();
+    m_wait_bytes = 0;
 }
 
 void RdsConnection::on_redis_disconnect_callback(const redisAsyncContext* ac, int status) {
     LOG_ERROR("redis disconnected!, host: %s, port: %d", ac->c.tcp.host, ac->c.tcp.port);
     set_state(STATE::CLOSED);
     m_ctx = nullptr;
+    if (status != REDIS_OK) {
+        on_connect_failed();
+    }
 }
 
 bool RdsConnection::send_to(
@@ -128,7 +183,14 @@ bool RdsConnection::send_to(
         return true;
     }
 
-    // LOG_DEBUG("send to redis, cmd: %s", format_redis_cmds(argv).c_str());
+    return send_cmd(argv, fn, privdata);
+}
+
+/* hiredis appends cmd to its output buffer and writes the buffer when
+ * the socket is writable, so the cmds sent in one loop are pipelined. */
+bool RdsConnection::send_cmd(
+    const std::vector<std::string>& argv, redisCallbackFn* fn, void* privdata) {
+    reply_t* r = nullptr;
 
     /* ok. send cmd to redis. */
     size_t arglen[argv.size()];
@@ -138,12 +200,62 @@ bool RdsConnection::send_to(
         rds_argv[i] = argv[i].c_str();
     }
 
-    int ret = redisAsyncCommandArgv(m_ctx, fn, privdata, argv.size(), rds_argv, arglen);
+    /* subscription's callback is called for every message, it is kept by
+     * hiredis until unsubscribed, so its privdata is not wrapped. */
+    if (is_subscribe_cmd(argv)) {
+        int ret = redisAsyncCommandArgv(m_ctx, fn, privdata, argv.size(), rds_argv, arglen);
+        if (ret != REDIS_OK) {
+            LOG_ERROR("redis subscribe failed! ret: %d, errno: %d, error: %s",
+                      ret, m_ctx->err, m_ctx->errstr);
+            return false;
+        }
+        return true;
+    }
+
+    if (m_free_replies.empty()) {
+        r = new reply_t;
+    } else {
+        r = m_free_replies.back();
+        m_free_replies.pop_back();
+    }
+    r->conn = this;
+    r->fn = fn;
+    r->privdata = privdata;
+
+    // LOG_DEBUG("send to redis, cmd: %s", format_redis_cmds(argv).c_str());
+
+    int ret = redisAsyncCommandArgv(m_ctx, on_reply_libev_callback, r, argv.size(), rds_argv, arglen);
     if (ret != REDIS_OK) {
         LOG_ERROR("redis send to failed! ret: %d, errno: %d, error: %s",
                   ret, m_ctx->err, m_ctx->errstr);
+        m_free_replies.push_back(r);
+        return false;
     }
-    return (ret == REDIS_OK);
+
+    m_pending_cnt++;
+    return true;
+}
+
+bool RdsConnection::is_subscribe_cmd(const std::vector<std::string>& argv) {
+    return strcasecmp(argv[0].c_str(), "subscribe") == 0 ||
+           strcasecmp(argv[0].c_str(), "psubscribe") == 0;
+}
+
+void RdsConnection::on_reply_libev_callback(redisAsyncContext* c, void* reply, void* privdata) {
+    reply_t* r = static_cast<reply_t*>(privdata);
+    redisCallbackFn* fn = r->fn;
+    void* data = r->privdata;
+    RdsConnection* conn = r->conn;
+
+    /* recycle before callback, connection may be closed in it. */
+    conn->m_pending_cnt--;
+    if (conn->m_free_replies.size() < MAX_FREE_REPLY_CNT) {
+        conn->m_free_replies.push_back(r);
+    } else {
+        delete r;
+    }
+
+    fn(c, reply, data);
 }
 
 bool RdsConnection::add_wait_task(
@@ -152,12 +264,23 @@ bool RdsConnection::add_wait_task(
         return false;
     }
 
+    /* bound the memory of cmds which wait for connection, fail fast. */
+    size_t size = sizeof(task_t);
+    for (const auto& arg : argv) {
+        size += sizeof(arg) + arg.length();
+    }
+    if (m_max_wait_bytes > 0 && m_wait_bytes + size > m_max_wait_bytes) {
+        m_reject_cnt++;
+        return false;
+    }
+
     // LOG_DEBUG("add wait task, redis cmd: %s", format_redis_cmds(argv).c_str());
     task_t* task = new task_t;
     task->fn = fn;
     task->argv = argv;
     task->privdata = privdata;
     m_wait_tasks.push_back(task);
+    m_wait_bytes += size;
     return true;
 }
 
@@ -179,4 +302,57 @@ void RdsConnection::wait_task_error_callback(
     c->errstr = old_errstr;
 }
 
+////////////////////////////////////////////////
+
+RdsConnPool::RdsConnPool(Log* logger, struct ev_loop* loop, const std::string& host,
+                         int port, int conn_cnt, size_t max_wait_bytes)
+    : m_logger(logger), m_loop(loop), m_host(host), m_port(port), m_max_wait_bytes(max_wait_bytes) {
+    m_conns.resize((conn_cnt > 0) ? conn_cnt : 1, nullptr);
+}
+
+RdsConnPool::~RdsConnPool() {
+    for (auto& c : m_conns) {
+        SAFE_DELETE(c);
+    }
+    m_conns.clear();
+}
+
+RdsConnection* RdsConnPool::get_conn() {
+    RdsConnection* c = nullptr;
+
+    for (auto& conn : m_conns) {
+        if (conn == nullptr) {
+            conn = new RdsConnection(m_logger, m_loop);
+            conn->set_max_wait_bytes(m_max_wait_bytes);
+        }
+        if (!conn->is_active()) {
+            if (!conn->can_connect()) {
+                continue;
+            }
+            if (!conn->connect(m_host, m_port)) {
+                LOG_ERROR("init redis conn failed! host: %s, port: %d.",
+                          m_host.c_str(), m_port);
+                continue;
+            }
+        }
+        if (c == nullptr || conn->pending_cnt() < c->pending_cnt()) {
+            c = conn;
+        }
+    }
+
+    if (c == nullptr) {
+        m_reject_cnt++;
+    }
+    return c;
+}
+
+void RdsConnPool::get_stats(RedisStats* stats) {
+    for (auto& conn : m_conns) {
+        if (conn != nullptr) {
+            conn->get_stats(stats);
+        }
+    }
+    stats->set_reject_cnt(stats->reject_cnt() + m_reject_cnt);
+}
+
 }  // namespace kim
\ No newline at end of file
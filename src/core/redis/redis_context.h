@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "net.h"
+#include "protobuf/sys/payload.pb.h"
 #include "server.h"
 #include "util/log.h"
 
@@ -20,12 +21,35 @@ class RdsConnection {
         void* privdata = nullptr;
     } task_t;
 
+    /* privdata of the sent cmd, to count the replies in flight. */
+    typedef struct reply_s {
+        RdsConnection* conn = nullptr;
+        redisCallbackFn* fn = nullptr;
+        void* privdata = nullptr;
+    } reply_t;
+
+    enum {
+        MAX_FREE_REPLY_CNT = 1024,
+        DEFAULT_MAX_WAIT_BYTES = 1024 * 1024,
+        MIN_RETRY_INTERVAL_MS = 100,
+        MAX_RETRY_INTERVAL_MS = 30 * 1000,
+    };
+
     enum class STATE {
         CONNECTING = 0,
         CONNECTED,
         CLOSED
     };
 
+    /* circuit breaker, OPEN: reconnect is not allowed until retry time,
+     * which is delayed exponentially by continuous failures, HALF_OPEN:
+     * reconnecting after failures. */
+    enum class BREAKER {
+        CLOSED = 0,
+        OPEN,
+        HALF_OPEN,
+    };
+
     RdsConnection(Log* logger, struct ev_loop* loop);
     virtual ~RdsConnection();
     bool connect(const std::string& host, int port);
@@ -37,13 +61,27 @@ class RdsConnection {
     bool is_active() { return (is_connecting() || is_connected()); }
     bool is_closed() { return m_state == STATE::CLOSED; }
 
+    /* false: breaker is open. */
+    bool can_connect();
+    bool is_breaker_open() { return m_breaker == BREAKER::OPEN; }
+    /* bytes of cmds which wait for connection, 0: no limit. */
+    void set_max_wait_bytes(size_t bytes) { m_max_wait_bytes = bytes; }
+    void get_stats(RedisStats* stats);
+
     int port() { return m_port; }
     const std::string& host() const { return m_host; }
     const char* host() { return m_host.c_str(); }
+    /* cmds which wait for connection or reply. */
+    size_t pending_cnt() const { return m_pending_cnt + m_wait_tasks.size(); }
 
    private:
     void destory();
     void set_state(RdsConnection::STATE s) { m_state = s; }
+    void on_connect_failed();
+
+    bool send_cmd(const std::vector<std::string>& argv, redisCallbackFn* fn, void* privdata);
+    static bool is_subscribe_cmd(const std::vector<std::string>& argv);
+    static void on_reply_libev_callback(redisAsyncContext* c, void* reply, void* privdata);
 
     // task.
     bool add_wait_task(const std::vector<std::string>& argv, redisCallbackFn* fn, void* privdata);
@@ -62,9 +100,47 @@ class RdsConnection {
     int m_port = 0;
     std::string m_host;
     std::list<task_t*> m_wait_tasks; /* add task to task list, before connection is ok.*/
+    size_t m_wait_bytes = 0;
+    size_t m_max_wait_bytes = DEFAULT_MAX_WAIT_BYTES;
 
     STATE m_state = STATE::CLOSED;
     redisAsyncContext* m_ctx = nullptr; /* hiredis async connection. */
+
+    size_t m_pending_cnt = 0;            /* cmds sent and wait for reply. */
+    std::vector<reply_t*> m_free_replies; /* reused reply privdata. */
+
+    BREAKER m_breaker = BREAKER::CLOSED;
+    int m_fail_cnt = 0;          /* continuous connect failures. */
+    double m_retry_time = 0;     /* reconnect is not allowed before it. */
+    uint32_t m_connect_fail_cnt = 0;
+    uint32_t m_reject_cnt = 0;   /* cmds failed fast by full wait queue. */
+};
+
+/* connections of a redis node, they are created when they are used. */
+class RdsConnPool {
+   public:
+    RdsConnPool(Log* logger, struct ev_loop* loop, const std::string& host, int port,
+                int conn_cnt, size_t max_wait_bytes = RdsConnection::DEFAULT_MAX_WAIT_BYTES);
+    virtual ~RdsConnPool();
+
+    RdsConnPool(const RdsConnPool&) = delete;
+    RdsConnPool& operator=(const RdsConnPool&) = delete;
+
+    /* the connection which has the least cmds in flight. */
+    RdsConnection* get_conn();
+    void get_stats(RedisStats* stats);
+
+    int port() const { return m_port; }
+    const std::string& host() const { return m_host; }
+
+   private:
+    Log* m_logger = nullptr;
+    struct ev_loop* m_loop = nullptr;
+    std::string m_host;
+    int m_port = 0;
+    size_t m_max_wait_bytes = 0;
+    std::vector<RdsConnection*> m_conns;
+    uint32_t m_reject_cnt = 0; /* cmds failed fast by open breakers. */
 };
 
 }  // namespace kim
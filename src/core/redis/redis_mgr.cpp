@@ -7,78 +7,144 @@ RedisMgr::RedisMgr(Log* logger, struct ev_loop* loop)
 }
 
 RedisMgr::~RedisMgr() {
-    m_addrs.clear();
-    for (auto& it : m_conns) {
-        SAFE_DELETE(it.second);
+    for (auto& it : m_nodes) {
+        close_node(it.second);
     }
-    m_conns.clear();
+    m_nodes.clear();
 }
 
 bool RedisMgr::init(CJsonObject& config) {
-    int port;
+    int port, conn_cnt, max_wait_mem;
+    bool is_cluster;
+    size_t max_wait_bytes;
     std::string host;
     std::vector<std::string> nodes;
     config.GetKeys(nodes);
 
     for (const auto& node : nodes) {
-        const CJsonObject& obj = config[node];
+        CJsonObject& obj = config[node];
         host = obj("host");
         port = str_to_int(obj("port"));
         if (host.empty() || port == 0) {
             LOG_ERROR("invalid redis node addr: %s", node.c_str());
-            m_addrs.clear();
             return false;
         }
-        m_addrs.insert({node, {host, port}});
+
+        conn_cnt = obj("conn_cnt").empty() ? DEFAULT_CONN_CNT : str_to_int(obj("conn_cnt"));
+        if (conn_cnt <= 0 || conn_cnt > MAX_CONN_CNT) {
+            LOG_ERROR("invalid redis node conn cnt: %s, cnt: %d", node.c_str(), conn_cnt);
+            return false;
+        }
+
+        max_wait_mem = DEFAULT_MAX_WAIT_MEM;
+        obj.Get("max_wait_mem", max_wait_mem);
+        if (max_wait_mem < 0) {
+            LOG_ERROR("invalid redis node max wait mem: %s, mem: %d", node.c_str(), max_wait_mem);
+            return false;
+        }
+        max_wait_bytes = (size_t)max_wait_mem * 1024 * 1024;
+
+        is_cluster = false;
+        obj.Get("cluster", is_cluster);
+
+        node_t& n = m_nodes[node];
+        if (!is_cluster) {
+            n.pool = new RdsConnPool(m_logger, m_loop, host, port, conn_cnt, max_wait_bytes);
+            if (!obj["cache"].IsEmpty() && !init_cache(n, obj["cache"], host, port)) {
+                LOG_ERROR("invalid redis node cache: %s", node.c_str());
+                return false;
+            }
+        } else {
+            if (!obj["cache"].IsEmpty()) {
+                LOG_ERROR("cache is not supported by redis cluster node: %s", node.c_str());
+                return false;
+            }
+            n.cluster = new RedisCluster(m_logger, m_loop, conn_cnt, max_wait_bytes);
+            n.cluster->add_seed(host, port);
+
+            CJsonObject& seeds = obj["seeds"];
+            for (int i = 0; i < seeds.GetArraySize(); i++) {
+                std::string seed = seeds(i);
+                size_t pos = seed.rfind(':');
+                if (pos == std::string::npos ||
+                    !n.cluster->add_seed(seed.substr(0, pos), str_to_int(seed.substr(pos + 1)))) {
+                    LOG_ERROR("invalid redis cluster seed: %s, node: %s", seed.c_str(), node.c_str());
+                    return false;
+                }
+            }
+        }
+
+        LOG_DEBUG("redis node: %s, addr: %s:%d, conn cnt: %d, cluster: %d",
+                  node.c_str(), host.c_str(), port, conn_cnt, is_cluster);
     }
 
     return true;
 }
 
+bool RedisMgr::init_cache(node_t& n, CJsonObject& obj, const std::string& host, int port) {
+    int ttl = DEFAULT_CACHE_TTL, max_mem = DEFAULT_CACHE_MAX_MEM;
+
+    obj.Get("max_mem", max_mem);
+    obj.Get("ttl", ttl);
+    if (max_mem <= 0 || ttl <= 0) {
+        return false;
+    }
+
+    n.cache = new RdsCache(m_logger, m_loop, host, port, (size_t)max_mem * 1024 * 1024, ttl);
+    LOG_DEBUG("redis node cache, addr: %s:%d, max mem: %dM, ttl: %d",
+              host.c_str(), port, max_mem, ttl);
+    return true;
+}
+
+void RedisMgr::close_node(node_t& n) {
+    /* the GETs in flight fill the cache when they are called back. */
+    SAFE_DELETE(n.pool);
+    SAFE_DELETE(n.cluster);
+    SAFE_DELETE(n.cache);
+}
+
 void RedisMgr::close(const char* node) {
     if (node == nullptr) {
         return;
     }
-    auto it = m_conns.find(node);
-    if (it == m_conns.end()) {
+    auto it = m_nodes.find(node);
+    if (it == m_nodes.end()) {
         return;
     }
-    SAFE_DELETE(it->second);
-    m_conns.erase(it);
-    m_addrs.erase(node);
+    close_node(it->second);
+    m_nodes.erase(it);
 }
 
-RdsConnection* RedisMgr::get_conn(const char* node) {
-    auto it = m_addrs.find(node);
-    if (it == m_addrs.end()) {
-        LOG_ERROR("invalid redis node: %s!", node);
-        return nullptr;
-    }
+void RedisMgr::get_stats(Payload& payload) {
+    RedisStats* stats;
 
-    RdsConnection* c = nullptr;
-    int port = it->second.second;
-    std::string host = it->second.first;
-    std::string identity = format_addr(host, port);
-
-    auto itr = m_conns.find(identity);
-    if (itr != m_conns.end()) {
-        c = itr->second;
-        if (c->is_active()) {
-            return c;
+    for (auto& it : m_nodes) {
+        stats = payload.add_redis();
+        stats->set_node(it.first);
+        if (it.second.pool != nullptr) {
+            it.second.pool->get_stats(stats);
+        } else if (it.second.cluster != nullptr) {
+            it.second.cluster->get_stats(stats);
         }
     }
+}
 
-    if (c == nullptr) {
-        c = new RdsConnection(m_logger, m_loop);
+bool RedisMgr::is_readonly_cmd(const std::vector<std::string>& argv) {
+    static const char* cmds[] = {
+        "get", "mget", "strlen", "getrange", "exists", "type", "ttl", "pttl",
+        "hget", "hmget", "hgetall", "hexists", "hlen", "hkeys", "hvals",
+        "llen", "lindex", "lrange", "scard", "sismember", "smembers",
+        "zcard", "zcount", "zrange", "zrangebyscore", "zrevrange", "zrank", "zscore"};
+
+    if (argv.size() < 2) {
+        return false;
     }
-    if (c == nullptr || !c->connect(host, port)) {
-        SAFE_DELETE(c);
-        LOG_ERROR("init redis conn failed! host: %s, port: %d.",
-                  host.c_str(), port);
-        return nullptr;
+    for (size_t i = 0; i < sizeof(cmds) / sizeof(cmds[0]); i++) {
+        if (strcasecmp(argv[0].c_str(), cmds[i]) == 0) {
+            return true;
+        }
     }
-    m_conns[identity] = c;
-    return c;
+    return false;
 }
 
 bool RedisMgr::send_to(const char* node, const std::vector<std::string>& argv,
@@ -88,13 +154,32 @@ bool RedisMgr::send_to(const char* node, const std::vector<std::string>& argv,
         return false;
     }
 
-    /* async hiredis client pressure 10w+ qps. it's ok for just one link. */
-    RdsConnection* c = get_conn(node);
+    auto it = m_nodes.find(node);
+    if (it == m_nodes.end()) {
+        LOG_ERROR("invalid redis node: %s!", node);
+        return false;
+    }
+
+    node_t& n = it->second;
+    if (n.cluster != nullptr) {
+        return n.cluster->send_to(argv, fn, privdata);
+    }
+
+    if (n.cache != nullptr && RdsCache::is_read_cmd(argv) &&
+        n.cache->reply(argv[1], fn, privdata)) {
+        return true;
+    }
+
+    RdsConnection* c = n.pool->get_conn();
     if (c == nullptr) {
         LOG_ERROR("get redis conn failed! node: %s", node);
         return false;
     }
+
+    if (n.cache != nullptr) {
+        return n.cache->send_to(c, argv, fn, privdata);
+    }
     return c->send_to(argv, fn, privdata);
 }
 
-}  // namespace kim
\ No newline at end of file
+}  // namespace kim
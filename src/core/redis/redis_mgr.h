@@ -1,6 +1,8 @@
 #ifndef __KIM_REDIS_MGR_H__
 #define __KIM_REDIS_MGR_H__
 
+#include "redis_cache.h"
+#include "redis_cluster.h"
 #include "redis_context.h"
 #include "util/json/CJsonObject.hpp"
 
@@ -8,22 +10,47 @@ namespace kim {
 
 class RedisMgr {
    public:
+    enum {
+        DEFAULT_CONN_CNT = 1,
+        MAX_CONN_CNT = 64,
+        DEFAULT_CACHE_MAX_MEM = 64, /* MB. */
+        DEFAULT_CACHE_TTL = 30,     /* seconds, backstop of lost notifications. */
+        DEFAULT_MAX_WAIT_MEM = 1,   /* MB. */
+    };
+
+    /* redis node, a single server or a cluster. */
+    typedef struct node_s {
+        RdsConnPool* pool = nullptr;
+        RedisCluster* cluster = nullptr;
+        RdsCache* cache = nullptr; /* GET's cache of single server. */
+    } node_t;
+
     RedisMgr(Log* logger, struct ev_loop* loop);
     virtual ~RedisMgr();
 
    public:
+    /* node: {"host": "127.0.0.1", "port": 6379, "conn_cnt": 4, "cluster": false},
+     * cluster's host and port is the seed, more seeds: "seeds": ["ip:port"].
+     * "max_wait_mem": MB of cmds which wait for connection, 0: no limit.
+     * GET cache of single server: "cache": {"max_mem": 64, "ttl": 30}, max_mem: MB, ttl: seconds, 0: no ttl. */
     bool init(CJsonObject& config);
     bool send_to(const char* node, const std::vector<std::string>& argv, redisCallbackFn* fn, void* privdata);
     void close(const char* node);
 
+    /* cmd which does not change data. */
+    static bool is_readonly_cmd(const std::vector<std::string>& argv);
+
+    /* wait queues and failures of nodes. */
+    void get_stats(Payload& payload);
+
    private:
-    RdsConnection* get_conn(const char* node);
+    bool init_cache(node_t& n, CJsonObject& obj, const std::string& host, int port);
+    void close_node(node_t& n);
 
    private:
     Log* m_logger = nullptr;
     struct ev_loop* m_loop = nullptr;
-    std::unordered_map<std::string, RdsConnection*> m_conns;                // redis connections.
-    std::unordered_map<std::string, std::pair<std::string, int> > m_addrs;  // node --> <ip, port>
+    std::unordered_map<std::string, node_t> m_nodes; /* key: node name. */
 };
 
 }  // namespace kim
@@ -34,10 +34,59 @@ Request::Request(const fd_t& f, const MsgHead& head, const MsgBody& body)
     CHECK_SET(m_msg_body, MsgBody, body);
 }
 
+Request::Request(const fd_t& f, bool is_http, google::protobuf::Arena* arena)
+    : m_is_http(is_http), m_is_arena(true), m_arena(arena) {
+    m_fd_data = f;
+    alloc_arena_msgs();
+}
+
+Request::Request(Request&& req)
+    : m_fd_data(req.m_fd_data),
+      m_is_http(req.m_is_http),
+      m_msg_head(req.m_msg_head),
+      m_msg_body(req.m_msg_body),
+      m_http_msg(req.m_http_msg),
+      m_is_arena(req.m_is_arena),
+      m_arena(req.m_arena) {
+    req.m_msg_head = nullptr;
+    req.m_msg_body = nullptr;
+    req.m_http_msg = nullptr;
+    req.m_arena = nullptr;
+}
+
 Request::~Request() {
+    if (m_arena != nullptr) {
+        /* msgs are released with the arena. */
+        SAFE_DELETE(m_arena);
+        return;
+    }
     SAFE_DELETE(m_msg_head);
     SAFE_DELETE(m_msg_body);
     SAFE_DELETE(m_http_msg);
 }
 
+void Request::alloc_arena_msgs() {
+    if (m_arena == nullptr) {
+        m_arena = new google::protobuf::Arena;
+    }
+    if (m_is_http) {
+        m_http_msg = google::protobuf::Arena::CreateMessage<HttpMsg>(m_arena);
+    } else {
+        m_msg_head = google::protobuf::Arena::CreateMessage<MsgHead>(m_arena);
+        m_msg_body = google::protobuf::Arena::CreateMessage<MsgBody>(m_arena);
+    }
+}
+
+void Request::clear() {
+    if (m_is_arena && m_arena == nullptr) {
+        /* msgs and arena have been moved to cmd. */
+        alloc_arena_msgs();
+        return;
+    }
+
+    if (m_msg_head != nullptr) m_msg_head->Clear();
+    if (m_msg_body != nullptr) m_msg_body->Clear();
+    if (m_http_msg != nullptr) m_http_msg->Clear();
+}
+
 };  // namespace kim
\ No newline at end of file
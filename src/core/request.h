@@ -1,6 +1,8 @@
 #ifndef __KIM_REQUEST_H__
 #define __KIM_REQUEST_H__
 
+#include <google/protobuf/arena.h>
+
 #include "connection.h"
 #include "protobuf/proto/http.pb.h"
 #include "protobuf/proto/msg.pb.h"
@@ -13,6 +15,10 @@ class Request {
     Request(const fd_t& f, bool is_http);
     Request(const fd_t& f, const HttpMsg& msg);
     Request(const fd_t& f, const MsgHead& head, const MsgBody& body);
+    /* msgs are allocated on an arena owned by request. */
+    Request(const fd_t& f, bool is_http, google::protobuf::Arena* arena);
+    /* take over the msgs and the arena, no deep copy. */
+    Request(Request&& req);
     virtual ~Request();
 
     Request() = delete;
@@ -22,6 +28,10 @@ class Request {
     const bool is_http() const { return m_is_http; }
     const int fd() const { return m_fd_data.fd; }
     const fd_t& fd_data() const { return m_fd_data; }
+    google::protobuf::Arena* arena() const { return m_arena; }
+
+    /* reuse msgs for next decoding, realloc them when they have been moved. */
+    void clear();
 
     void set_msg_head(const MsgHead& head) { CHECK_SET(m_msg_head, MsgHead, head); }
     void set_msg_body(const MsgBody& body) { CHECK_SET(m_msg_body, MsgBody, body); }
@@ -40,6 +50,11 @@ class Request {
     MsgHead* m_msg_head = nullptr;  // protobuf msg head.
     MsgBody* m_msg_body = nullptr;  // protobuf msg body.
     HttpMsg* m_http_msg = nullptr;  // http msg.
+    bool m_is_arena = false;
+    google::protobuf::Arena* m_arena = nullptr;  // msgs' memory.
+
+   private:
+    void alloc_arena_msgs();
 };
 
 };  // namespace kim
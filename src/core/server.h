@@ -34,16 +34,22 @@ enum class E_RDS_STATUS {
 #define IO_TIMEOUT_VAL 15.0        // connection time out value.
 #define CMD_TIMEOUT_VAL 3.0        // cmd time out value.
 #define REPEAT_TIMEOUT_VAL 1.0     // repeat time out value.
+#define ROUTE_TIMEOUT_VAL 1.0      // client's fd waits for its first request to dispatch.
 
 #define MAX_PATH 256
 #define TCP_BACK_LOG 511
 #define NET_IP_STR_LEN 46 /* INET6_ADDRSTRLEN is 46, but we need to be sure */
 #define MAX_ACCEPTS_PER_CALL 1000
+#define HTTP_PIPELINE_DEPTH 16 /* max http requests in processing per connection. */
 
 // logger macro.
-#define LOG_FORMAT(level, args...)                                           \
-    if (m_logger != nullptr) {                                               \
-        m_logger->log_data(__FILE__, __LINE__, __FUNCTION__, level, ##args); \
+/* check level before arguments are evaluated,
+ * call site caches its binary log site id, registered once. */
+#define LOG_FORMAT(level, args...)                                                       \
+    if ((level) <= LOG_COMPILE_LEVEL && m_logger != nullptr &&                           \
+        m_logger->is_level_enabled(level)) {                                             \
+        static std::atomic<uint64_t> __log_site{0};                                      \
+        m_logger->log_data(&__log_site, __FILE__, __LINE__, __FUNCTION__, level, ##args); \
     }
 
 #define LOG_EMERG(args...) LOG_FORMAT((kim::Log::LL_EMERG), ##args)
@@ -24,13 +24,16 @@ void Session::init(const std::string& sessid, double timeout) {
 
 SessionMgr::~SessionMgr() {
     for (auto& it : m_sessions) {
-        Session* s = it.second;
-        if (s != nullptr) {
-            events()->del_timer_event(s->timer());
-            SAFE_DELETE(s);
-        }
+        SAFE_DELETE(it.second);
     }
     m_sessions.clear();
+    m_lru_head = m_lru_tail = nullptr;
+}
+
+void SessionMgr::set_limits(size_t max_cnt, size_t max_bytes) {
+    m_max_cnt = max_cnt;
+    m_max_bytes = max_bytes;
+    evict(nullptr);
 }
 
 bool SessionMgr::add_session(Session* s) {
@@ -38,64 +41,166 @@ bool SessionMgr::add_session(Session* s) {
         return false;
     }
     const std::string& sessid = s->sessid();
-    auto it = m_sessions.find(sessid);
-    if (it != m_sessions.end()) {
-        s->set_active_time(net()->now());
+    Session** ps = m_sessions.find(sessid);
+    if (ps != nullptr) {
+        (*ps)->set_active_time(net()->now());
+        lru_touch(*ps);
+        account(*ps);
         return true;
     }
-    m_sessions[sessid] = s;
-    ev_timer* w = events()->add_session_timer(s->keep_alive(), s->timer(), s);
-    if (w == nullptr) {
-        m_sessions.erase(sessid);
+
+    if (!m_sessions.insert(sessid, s)) {
         LOG_ERROR("add session(%s) failed!", s->name());
         return false;
     }
-    s->set_timer(w);
+
+    lru_add(s);
+    account(s);
+    evict(s);
     return true;
 }
 
-Session* SessionMgr::get_session(const std::string& sessid, bool re_active) {
-    auto it = m_sessions.find(sessid);
-    if (it == m_sessions.end()) {
+Session* SessionMgr::get_session(const StrView& sessid, bool re_active) {
+    Session** ps = m_sessions.find(sessid);
+    if (ps == nullptr) {
+        m_miss_cnt++;
         return nullptr;
     }
+
+    m_hit_cnt++;
+    Session* s = *ps;
     if (re_active) {
-        it->second->set_active_time(events()->now());
+        s->set_active_time(events()->now());
+        lru_touch(s);
+        account(s);
     }
-    return it->second;
+    return s;
 }
 
-bool SessionMgr::del_session(const std::string& sessid) {
-    auto it = m_sessions.find(sessid);
-    if (it == m_sessions.end()) {
+bool SessionMgr::del_session(const StrView& sessid) {
+    Session** ps = m_sessions.find(sessid);
+    if (ps == nullptr) {
         return false;
     }
+    remove(*ps);
+    return true;
+}
 
-    Session* s = it->second;
-    if (s != nullptr) {
-        events()->del_timer_event(s->timer());
-        SAFE_DELETE(s);
+void SessionMgr::remove(Session* s) {
+    /* erase before deleting, sessid's view may point to session. */
+    m_sessions.erase(s->sessid());
+    lru_del(s);
+    m_bytes -= s->m_mem_size;
+    account_keep_alive(s, true);
+    SAFE_DELETE(s);
+}
+
+void SessionMgr::lru_add(Session* s) {
+    s->m_lru_prev = nullptr;
+    s->m_lru_next = m_lru_head;
+    if (m_lru_head != nullptr) {
+        m_lru_head->m_lru_prev = s;
+    }
+    m_lru_head = s;
+    if (m_lru_tail == nullptr) {
+        m_lru_tail = s;
     }
+}
 
-    m_sessions.erase(it);
-    return true;
+void SessionMgr::lru_del(Session* s) {
+    if (s->m_lru_prev != nullptr) {
+        s->m_lru_prev->m_lru_next = s->m_lru_next;
+    } else {
+        m_lru_head = s->m_lru_next;
+    }
+    if (s->m_lru_next != nullptr) {
+        s->m_lru_next->m_lru_prev = s->m_lru_prev;
+    } else {
+        m_lru_tail = s->m_lru_prev;
+    }
+    s->m_lru_prev = s->m_lru_next = nullptr;
+}
+
+void SessionMgr::lru_touch(Session* s) {
+    if (m_lru_head != s) {
+        lru_del(s);
+        lru_add(s);
+    }
 }
 
-void SessionMgr::on_session_timer(void* privdata) {
-    Session* s = static_cast<Session*>(privdata);
-    double secs = s->keep_alive() - (net()->now() - s->active_time());
-    if (secs > 0) {
-        LOG_TRACE("session timer restart, sessid: %llu, restart timer secs: %f",
-                  s->sessid(), secs);
-        events()->restart_timer(secs, s->timer(), privdata);
+void SessionMgr::account(Session* s) {
+    size_t size = s->mem_size();
+    m_bytes = m_bytes - s->m_mem_size + size;
+    s->m_mem_size = size;
+    account_keep_alive(s);
+}
+
+void SessionMgr::account_keep_alive(Session* s, bool is_del) {
+    if (!is_del && s->m_keep_alive == s->keep_alive()) {
         return;
     }
 
+    if (s->m_keep_alive >= 0) {
+        auto it = m_keep_alives.find(s->m_keep_alive);
+        if (it != m_keep_alives.end() && --it->second == 0) {
+            m_keep_alives.erase(it);
+        }
+        s->m_keep_alive = -1;
+    }
+
+    if (!is_del) {
+        s->m_keep_alive = s->keep_alive();
+        m_keep_alives[s->m_keep_alive]++;
+    }
+}
+
+void SessionMgr::evict(Session* keep) {
+    Session* s;
+
+    while ((m_max_cnt > 0 && m_sessions.size() > m_max_cnt) ||
+           (m_max_bytes > 0 && m_bytes > m_max_bytes)) {
+        s = m_lru_tail;
+        if (s == nullptr || s == keep) {
+            break;
+        }
+
+        LOG_DEBUG("evict session, sessid: %s, cnt: %lu, bytes: %lu",
+                  s->sessid(), m_sessions.size(), m_bytes);
+        s->on_timeout();
+        remove(s);
+        m_evict_cnt++;
+    }
+}
+
+void SessionMgr::on_repeat_timer() {
+    int cnt = 0;
+    double min_keep_alive, now = net()->now();
+    Session *s, *prev;
+
+    if (m_keep_alives.empty()) {
+        return;
+    }
+    min_keep_alive = m_keep_alives.begin()->first;
+
+    /* from the least recently active one, bounded by the nodes visited. */
+    for (s = m_lru_tail; s != nullptr && cnt < SWEEP_MAX_CNT; s = prev, cnt++) {
+        if (s->active_time() + min_keep_alive > now) {
+            break;
+        }
+        prev = s->m_lru_prev;
+        if (s->active_time() + s->keep_alive() <= now) {
+            expire(s, now);
+        }
+    }
+}
+
+void SessionMgr::expire(Session* s, double now) {
     int old = s->cur_timeout_cnt();
     Session::STATUS status = s->on_timeout();
     if (status != Session::STATUS::RUNNING) {
         LOG_TRACE("timeout del session, sessid: %s", s->sessid());
-        del_session(s->sessid());
+        remove(s);
+        m_expire_cnt++;
         return;
     }
 
@@ -105,13 +210,16 @@ void SessionMgr::on_session_timer(void* privdata) {
 
     if (s->cur_timeout_cnt() >= s->max_timeout_cnt()) {
         LOG_DEBUG("timeout del session, sessid: %s", s->sessid());
-        del_session(s->sessid());
+        remove(s);
+        m_expire_cnt++;
         return;
     }
 
-    LOG_TRACE("session timer reset, session id: %llu, restart timer secs: %f",
-              s->id(), secs);
-    events()->restart_timer(s->keep_alive(), s->timer(), privdata);
+    /* session keeps running, wait for another keep alive time. */
+    LOG_TRACE("session timer reset, session id: %llu", s->id());
+    s->set_active_time(now);
+    lru_touch(s);
+    account(s);
 }
 
 }  // namespace kim
\ No newline at end of file
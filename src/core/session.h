@@ -1,6 +1,8 @@
 #ifndef __KIM_SESSION_H__
 #define __KIM_SESSION_H__
 
+#include <map>
+
 #include "base.h"
 #include "timer.h"
 
@@ -22,26 +24,99 @@ class Session : public Timer, public Base {
     const char* sessid() { return m_sessid.c_str(); }
 
    public:
+    /* called when session expires, or it is evicted by session store
+     * (then the status is ignored, it is deleted anyway). */
     virtual Session::STATUS on_timeout() { return STATUS::OK; }
+    /* memory used by session, for the memory budget of session store,
+     * the derived session which keeps much data should override it. */
+    virtual size_t mem_size() const { return sizeof(*this) + m_sessid.capacity(); }
 
    protected:
     std::string m_sessid;
+
+   private:
+    friend class SessionMgr;
+    /* intrusive lru list of session store. */
+    Session* m_lru_prev = nullptr;
+    Session* m_lru_next = nullptr;
+    size_t m_mem_size = 0;     /* size accounted by session store. */
+    double m_keep_alive = -1;  /* keep alive accounted by session store. */
 };
 
+/* bounded session store, sessions are linked in a lru list by active
+ * time, the least recently active ones are evicted when the count or
+ * memory budget is exceeded, expired ones are removed by one sweep
+ * per second instead of a timer per session. */
 class SessionMgr : public Base {
    public:
+    enum {
+        SWEEP_MAX_CNT = 1000, /* max sessions visited in one sweep. */
+    };
+
     SessionMgr(Log* logger, INet* net) : Base(0, logger, net) {}
     virtual ~SessionMgr();
 
+    /* 0: no limit. */
+    void set_limits(size_t max_cnt, size_t max_bytes);
+
     bool add_session(Session* s);
-    Session* get_session(const std::string& sessid, bool re_active = false);
-    bool del_session(const std::string& sessid);
+    /* lookup by view, no key string is built. */
+    Session* get_session(const StrView& sessid, bool re_active = false);
+    bool del_session(const StrView& sessid);
 
-    // callback.
-    void on_session_timer(void* privdata);
+    /* sweep expired sessions. */
+    void on_repeat_timer();
+
+    /* delete the sessions which fn(s) returns true for. */
+    template <typename F>
+    size_t del_sessions_if(F fn) {
+        size_t cnt = 0;
+        Session *s, *next;
+        for (s = m_lru_head; s != nullptr; s = next) {
+            next = s->m_lru_next;
+            if (fn(s)) {
+                remove(s);
+                cnt++;
+            }
+        }
+        return cnt;
+    }
+
+    /* stats. */
+    size_t size() const { return m_sessions.size(); }
+    size_t bytes() const { return m_bytes; }
+    uint64_t hit_cnt() const { return m_hit_cnt; }
+    uint64_t miss_cnt() const { return m_miss_cnt; }
+    uint64_t evict_cnt() const { return m_evict_cnt; }
+    uint64_t expire_cnt() const { return m_expire_cnt; }
+
+   private:
+    void lru_add(Session* s);
+    void lru_del(Session* s);
+    void lru_touch(Session* s);
+    /* refresh session's accounted memory. */
+    void account(Session* s);
+    void account_keep_alive(Session* s, bool is_del = false);
+    void evict(Session* keep);
+    void expire(Session* s, double now);
+    void remove(Session* s);
 
    private:
-    std::unordered_map<std::string, Session*> m_sessions;
+    FlatMap<std::string, Session*> m_sessions;
+    Session* m_lru_head = nullptr; /* most recently active. */
+    Session* m_lru_tail = nullptr; /* least recently active. */
+
+    size_t m_max_cnt = 0;
+    size_t m_max_bytes = 0;
+    size_t m_bytes = 0;
+    /* sweep stops at the session which can not expire,
+     * key: sessions' keep alive, value: count. */
+    std::map<double, size_t> m_keep_alives;
+
+    uint64_t m_hit_cnt = 0;
+    uint64_t m_miss_cnt = 0;
+    uint64_t m_evict_cnt = 0;
+    uint64_t m_expire_cnt = 0;
 };
 
 }  // namespace kim
@@ -456,22 +456,18 @@ Cmd::STATUS SysCmd::on_req_update_payload(const Request& req) {
     LOG_TRACE("handle CMD_REQ_UPDATE_PAYLOAD. fd: % d", req.fd());
 
     kim::Payload pl;
-    worker_info_t* info;
 
     if (!pl.ParseFromString(req.msg_body()->data())) {
         LOG_ERROR("parse CMD_REQ_UPDATE_PAYLOAD data failed! fd: %d", req.fd());
         return Cmd::STATUS::ERROR;
     }
 
-    info = m_net->worker_data_mgr()->get_worker_info(pl.worker_index());
-    if (info == nullptr) {
+    if (!m_net->worker_data_mgr()->update_payload(pl)) {
         m_net->send_ack(req, ERR_INVALID_WORKER_INDEX, "can not find worker index!");
         LOG_ERROR("can not find worker index: %d", pl.worker_index());
         return Cmd::STATUS::ERROR;
     }
 
-    info->payload = pl;
-
     if (!m_net->send_ack(req, ERR_OK, "ok")) {
         LOG_ERROR("send CMD_RSP_UPDATE_PAYLOAD failed! fd: %d", req.fd());
         return Cmd::STATUS::ERROR;
@@ -1,8 +1,7 @@
 #ifndef __KIM_TIMER_H__
 #define __KIM_TIMER_H__
 
-#include <ev.h>
-
+#include "timer_wheel.h"
 #include "util/util.h"
 
 namespace kim {
@@ -12,8 +11,8 @@ class Timer {
     Timer() {}
     virtual ~Timer() {}
 
-    void set_timer(ev_timer* w) { m_timer = w; }
-    ev_timer* timer() { return m_timer; }
+    void set_timer(wheel_timer_t* w) { m_timer = w; }
+    wheel_timer_t* timer() { return m_timer; }
 
     void set_active_time(double t) { m_active_time = t; }
     double active_time() const { return m_active_time; }
@@ -28,7 +27,7 @@ class Timer {
     void refresh_cur_timeout_cnt() { ++m_cur_timeout_cnt; }
 
    protected:
-    ev_timer* m_timer = nullptr;
+    wheel_timer_t* m_timer = nullptr;
     double m_active_time = 0;  // connection last active (read/write) time.
     double m_keep_alive = 0;
     int m_cur_timeout_cnt = 0;
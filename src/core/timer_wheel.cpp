@@ -0,0 +1,172 @@
+#include "timer_wheel.h"
+
+#include <math.h>
+
+namespace kim {
+
+TimerWheel::TimerWheel(double tick) : m_tick(tick > 0 ? tick : DEFAULT_TICK) {
+    for (int i = 0; i < NEAR_SIZE; i++) {
+        list_init(&m_near[i]);
+    }
+    for (int i = 0; i < LEVEL_CNT; i++) {
+        for (int j = 0; j < LEVEL_SIZE; j++) {
+            list_init(&m_levels[i][j]);
+        }
+    }
+}
+
+TimerWheel::~TimerWheel() {
+    /* timers are owned by users, just detach them. */
+    for (int i = 0; i < NEAR_SIZE; i++) {
+        while (m_near[i].next != &m_near[i]) {
+            list_del(m_near[i].next);
+        }
+    }
+    for (int i = 0; i < LEVEL_CNT; i++) {
+        for (int j = 0; j < LEVEL_SIZE; j++) {
+            while (m_levels[i][j].next != &m_levels[i][j]) {
+                list_del(m_levels[i][j].next);
+            }
+        }
+    }
+    m_cnt = 0;
+}
+
+void TimerWheel::list_init(wheel_timer_t* head) {
+    head->prev = head->next = head;
+}
+
+void TimerWheel::list_add(wheel_timer_t* head, wheel_timer_t* w) {
+    w->prev = head->prev;
+    w->next = head;
+    head->prev->next = w;
+    head->prev = w;
+}
+
+void TimerWheel::list_del(wheel_timer_t* w) {
+    w->prev->next = w->next;
+    w->next->prev = w->prev;
+    w->prev = w->next = nullptr;
+}
+
+void TimerWheel::start(double now) {
+    m_cur_tick = to_tick(now);
+}
+
+void TimerWheel::add(wheel_timer_t* w, double now, double secs) {
+    if (m_cur_tick == 0) {
+        start(now);
+    }
+    if (is_active(w)) {
+        del(w);
+    }
+    w->expire = (uint64_t)ceil((now + secs) / m_tick);
+    link(w);
+    m_cnt++;
+}
+
+void TimerWheel::del(wheel_timer_t* w) {
+    if (is_active(w)) {
+        list_del(w);
+        m_cnt--;
+    }
+}
+
+void TimerWheel::link(wheel_timer_t* w) {
+    uint64_t idx;
+    wheel_timer_t* head = nullptr;
+
+    if (w->expire < m_cur_tick) {
+        w->expire = m_cur_tick;
+    }
+
+    idx = w->expire - m_cur_tick;
+    if (idx < NEAR_SIZE) {
+        head = &m_near[w->expire & (NEAR_SIZE - 1)];
+    } else {
+        for (int i = 0; i < LEVEL_CNT; i++) {
+            int shift = NEAR_BITS + i * LEVEL_BITS;
+            if (idx < (1ULL << (shift + LEVEL_BITS)) || i == LEVEL_CNT - 1) {
+                if (idx >= (1ULL << (shift + LEVEL_BITS))) {
+                    /* too far, fire at the max range, and it will be refreshed. */
+                    w->expire = m_cur_tick + (1ULL << (shift + LEVEL_BITS)) - 1;
+                }
+                head = &m_levels[i][(w->expire >> shift) & (LEVEL_SIZE - 1)];
+                break;
+            }
+        }
+    }
+
+    list_add(head, w);
+}
+
+uint64_t TimerWheel::cascade(int level) {
+    wheel_timer_t list, *w;
+    uint64_t index = (m_cur_tick >> (NEAR_BITS + level * LEVEL_BITS)) & (LEVEL_SIZE - 1);
+    wheel_timer_t* head = &m_levels[level][index];
+
+    if (head->next == head) {
+        return index;
+    }
+
+    /* move the slot's timers down to lower levels. */
+    list.next = head->next;
+    list.prev = head->prev;
+    list.next->prev = &list;
+    list.prev->next = &list;
+    list_init(head);
+
+    while (list.next != &list) {
+        w = list.next;
+        list_del(w);
+        link(w);
+    }
+    return index;
+}
+
+int TimerWheel::run(double now) {
+    int cnt = 0;
+    uint64_t index, now_tick;
+    wheel_timer_t list, *w;
+
+    now_tick = to_tick(now);
+    if (m_cur_tick == 0) {
+        m_cur_tick = now_tick;
+    }
+
+    while (m_cur_tick <= now_tick) {
+        index = m_cur_tick & (NEAR_SIZE - 1);
+        if (index == 0) {
+            for (int i = 0; i < LEVEL_CNT; i++) {
+                if (cascade(i) != 0) {
+                    break;
+                }
+            }
+        }
+
+        m_cur_tick++;
+
+        wheel_timer_t* head = &m_near[index];
+        if (head->next == head) {
+            continue;
+        }
+
+        list.next = head->next;
+        list.prev = head->prev;
+        list.next->prev = &list;
+        list.prev->next = &list;
+        list_init(head);
+
+        /* callback may add or delete timers, even the ones in list. */
+        while (list.next != &list) {
+            w = list.next;
+            list_del(w);
+            m_cnt--;
+            cnt++;
+            w->cb(w);
+        }
+    }
+    return cnt;
+}
+
+}  // namespace kim
@@ -0,0 +1,73 @@
+#ifndef __KIM_TIMER_WHEEL_H__
+#define __KIM_TIMER_WHEEL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace kim {
+
+typedef struct wheel_timer_s wheel_timer_t;
+typedef void (*cb_wheel_timer)(wheel_timer_t*);
+
+/* timer node, linked in wheel's slot. */
+struct wheel_timer_s {
+    wheel_timer_t* prev;
+    wheel_timer_t* next; /* nullptr: not in wheel. */
+    uint64_t expire;     /* expire tick. */
+    cb_wheel_timer cb;   /* callback fn. */
+    void* data;          /* private data. */
+};
+
+/* hierarchical timing wheel (like linux kernel's old timer wheel),
+ * 256 slots for near ticks and three levels of 64 slots for far ones,
+ * add, refresh and cancel are O(1), timers cascade down when time goes. */
+class TimerWheel {
+   public:
+    TimerWheel(double tick = DEFAULT_TICK);
+    virtual ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    static constexpr double DEFAULT_TICK = 0.1; /* seconds. */
+
+    /* set current time, before adding timers. */
+    void start(double now);
+    /* add or refresh timer, fire after secs. */
+    void add(wheel_timer_t* w, double now, double secs);
+    void del(wheel_timer_t* w);
+    bool is_active(const wheel_timer_t* w) const { return w->next != nullptr; }
+    /* run the timers which expire before now. */
+    int run(double now);
+
+    double tick() const { return m_tick; }
+    size_t size() const { return m_cnt; }
+
+   private:
+    enum {
+        NEAR_BITS = 8,
+        NEAR_SIZE = 1 << NEAR_BITS,
+        LEVEL_BITS = 6,
+        LEVEL_SIZE = 1 << LEVEL_BITS,
+        LEVEL_CNT = 3,
+    };
+
+    uint64_t to_tick(double t) const { return (uint64_t)(t / m_tick); }
+    void link(wheel_timer_t* w);
+    uint64_t cascade(int level);
+    static void list_init(wheel_timer_t* head);
+    static void list_add(wheel_timer_t* head, wheel_timer_t* w);
+    static void list_del(wheel_timer_t* w);
+
+   private:
+    double m_tick = DEFAULT_TICK;
+    uint64_t m_cur_tick = 0; /* next tick to run. */
+    size_t m_cnt = 0;        /* timers in wheel. */
+    /* slot's head is a sentinel node. */
+    wheel_timer_t m_near[NEAR_SIZE];
+    wheel_timer_t m_levels[LEVEL_CNT][LEVEL_SIZE];
+};
+
+}  // namespace kim
+
+#endif  //__KIM_TIMER_WHEEL_H__
@@ -0,0 +1,47 @@
+#include "clock.h"
+
+#include <stdio.h>
+#include <sys/time.h>
+#include <time.h>
+
+namespace kim {
+
+thread_local bool Clock::m_is_cached = false;
+thread_local double Clock::m_now = 0;
+thread_local int64_t Clock::m_now_ms = 0;
+thread_local double Clock::m_wall_time = 0;
+thread_local int64_t Clock::m_wall_secs = -1;
+thread_local int Clock::m_ms_offset = 0;
+thread_local char Clock::m_timestamp[32] = {0};
+
+void Clock::set_cached(bool cached) {
+    m_is_cached = cached;
+    if (cached) {
+        update();
+    }
+}
+
+void Clock::update() {
+    struct timespec ts;
+    struct timeval tv;
+    struct tm tm;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    m_now_ms = (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    m_now = ts.tv_sec + ts.tv_nsec * 1e-9;
+
+    gettimeofday(&tv, NULL);
+    m_wall_time = tv.tv_sec + tv.tv_usec * 1e-6;
+
+    /* date part changes once a second. */
+    if (m_wall_secs != (int64_t)tv.tv_sec) {
+        time_t t = tv.tv_sec;
+        localtime_r(&t, &tm);
+        m_ms_offset = strftime(m_timestamp, sizeof(m_timestamp), "[%Y-%m-%d %H:%M:%S.", &tm);
+        m_wall_secs = tv.tv_sec;
+    }
+    snprintf(m_timestamp + m_ms_offset, sizeof(m_timestamp) - m_ms_offset,
+             "%03d]", (int)tv.tv_usec / 1000);
+}
+
+}  // namespace kim
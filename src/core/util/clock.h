@@ -0,0 +1,54 @@
+#ifndef __KIM_CLOCK_H__
+#define __KIM_CLOCK_H__
+
+#include <stdint.h>
+
+namespace kim {
+
+/* coarse clock of process, it is updated once per event loop iteration,
+ * hot paths (log, timers, payload) read the cached time instead of calling
+ * clock_gettime / gettimeofday / localtime every time.
+ * it reads real time when it is not cached (loop is not running),
+ * the cache is thread local, other threads (zk, mysql) read real time. */
+class Clock {
+   public:
+    /* refresh cached time. */
+    static void update();
+    static void set_cached(bool cached);
+    static bool is_cached() { return m_is_cached; }
+
+    /* monotonic time. */
+    static double now() {
+        if (!m_is_cached) update();
+        return m_now;
+    }
+    static int64_t now_ms() {
+        if (!m_is_cached) update();
+        return m_now_ms;
+    }
+
+    /* wall clock time (seconds). */
+    static double wall_time() {
+        if (!m_is_cached) update();
+        return m_wall_time;
+    }
+
+    /* wall clock time string: [2020-01-01 00:00:00.000] */
+    static const char* timestamp() {
+        if (!m_is_cached) update();
+        return m_timestamp;
+    }
+
+   private:
+    static thread_local bool m_is_cached;
+    static thread_local double m_now;
+    static thread_local int64_t m_now_ms;
+    static thread_local double m_wall_time;
+    static thread_local int64_t m_wall_secs; /* formatted seconds of timestamp. */
+    static thread_local int m_ms_offset;     /* milliseconds' offset of timestamp. */
+    static thread_local char m_timestamp[32];
+};
+
+}  // namespace kim
+
+#endif  //__KIM_CLOCK_H__
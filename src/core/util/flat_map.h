@@ -0,0 +1,264 @@
+#ifndef __KIM_FLAT_MAP_H__
+#define __KIM_FLAT_MAP_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace kim {
+
+/* string's view, lookup by it without building a std::string. */
+class StrView {
+   public:
+    StrView() {}
+    StrView(const char* s) : m_data(s), m_size((s != nullptr) ? strlen(s) : 0) {}
+    StrView(const char* s, size_t len) : m_data(s), m_size(len) {}
+    StrView(const std::string& s) : m_data(s.data()), m_size(s.size()) {}
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    std::string to_string() const { return std::string(m_data, m_size); }
+
+   private:
+    const char* m_data = "";
+    size_t m_size = 0;
+};
+
+/* hash and equal functions of FlatMap. */
+struct FlatHash {
+    uint32_t operator()(uint64_t key) const {
+        /* murmur3's fmix64. */
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return (uint32_t)key;
+    }
+
+    uint32_t operator()(const StrView& key) const {
+        /* fnv1a. */
+        uint32_t hash = 2166136261U;
+        const char* p = key.data();
+        for (size_t i = 0; i < key.size(); i++) {
+            hash ^= (uint8_t)p[i];
+            hash *= 16777619U;
+        }
+        return hash;
+    }
+    uint32_t operator()(const std::string& key) const { return (*this)(StrView(key)); }
+    uint32_t operator()(const char* key) const { return (*this)(StrView(key)); }
+};
+
+struct FlatEqual {
+    bool operator()(uint64_t a, uint64_t b) const { return a == b; }
+    bool operator()(const std::string& a, const StrView& b) const {
+        return a.size() == b.size() && memcmp(a.data(), b.data(), b.size()) == 0;
+    }
+    bool operator()(const std::string& a, const std::string& b) const { return a == b; }
+    bool operator()(const std::string& a, const char* b) const { return (*this)(a, StrView(b)); }
+};
+
+/* open addressing hash map with linear probing, slots are in one array,
+ * so lookups walk contiguous memory, no node is allocated per item.
+ * erasing shifts the following items back, no tombstone is left.
+ * do not erase items when iterating. */
+template <typename K, typename V, typename H = FlatHash, typename E = FlatEqual>
+class FlatMap {
+   public:
+    typedef struct slot_s {
+        K first;
+        V second;
+        uint32_t hash = 0;
+        bool used = false;
+    } slot_t;
+
+    class iterator {
+       public:
+        iterator(std::vector<slot_t>* slots, size_t i) : m_slots(slots), m_index(i) { skip(); }
+        slot_t& operator*() const { return (*m_slots)[m_index]; }
+        slot_t* operator->() const { return &(*m_slots)[m_index]; }
+        iterator& operator++() {
+            m_index++;
+            skip();
+            return *this;
+        }
+        bool operator==(const iterator& it) const { return m_index == it.m_index; }
+        bool operator!=(const iterator& it) const { return m_index != it.m_index; }
+
+       private:
+        void skip() {
+            while (m_index < m_slots->size() && !(*m_slots)[m_index].used) m_index++;
+        }
+
+       private:
+        std::vector<slot_t>* m_slots;
+        size_t m_index;
+    };
+
+    FlatMap(size_t cap = 16) { m_slots.resize(round_up(cap)); }
+
+    iterator begin() { return iterator(&m_slots, 0); }
+    iterator end() { return iterator(&m_slots, m_slots.size()); }
+    size_t size() const { return m_cnt; }
+    bool empty() const { return m_cnt == 0; }
+
+    void clear() {
+        size_t cap = m_slots.size();
+        m_slots.clear();
+        m_slots.resize(cap);
+        m_cnt = 0;
+    }
+
+    /* Q: key or the type which is hashed and compared like key, like StrView. */
+    template <typename Q>
+    V* find(const Q& key) {
+        size_t i = find_index(key, m_hash(key));
+        return (i != NPOS) ? &m_slots[i].second : nullptr;
+    }
+
+    /* false: key exists. */
+    bool insert(const K& key, const V& value) {
+        uint32_t hash = m_hash(key);
+        if (find_index(key, hash) != NPOS) {
+            return false;
+        }
+        if ((m_cnt + 1) * 4 > m_slots.size() * 3) {
+            rehash(m_slots.size() * 2);
+        }
+        place(key, value, hash);
+        return true;
+    }
+
+    template <typename Q>
+    bool erase(const Q& key) {
+        size_t i, j, k;
+        size_t mask = m_slots.size() - 1;
+
+        i = find_index(key, m_hash(key));
+        if (i == NPOS) {
+            return false;
+        }
+
+        /* shift back the items which are not at their home slot. */
+        for (j = (i + 1) & mask; m_slots[j].used; j = (j + 1) & mask) {
+            k = m_slots[j].hash & mask;
+            if ((i <= j) ? (k <= i || k > j) : (k <= i && k > j)) {
+                m_slots[i] = std::move(m_slots[j]);
+                i = j;
+            }
+        }
+
+        m_slots[i] = slot_t();
+        m_cnt--;
+        return true;
+    }
+
+   private:
+    static const size_t NPOS = (size_t)-1;
+
+    static size_t round_up(size_t n) {
+        size_t cap = 16;
+        while (cap < n) cap <<= 1;
+        return cap;
+    }
+
+    template <typename Q>
+    size_t find_index(const Q& key, uint32_t hash) const {
+        size_t mask = m_slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            const slot_t& s = m_slots[i];
+            if (!s.used) {
+                return NPOS;
+            }
+            if (s.hash == hash && m_equal(s.first, key)) {
+                return i;
+            }
+        }
+    }
+
+    void place(const K& key, const V& value, uint32_t hash) {
+        size_t mask = m_slots.size() - 1;
+        size_t i = hash & mask;
+        while (m_slots[i].used) i = (i + 1) & mask;
+        slot_t& s = m_slots[i];
+        s.first = key;
+        s.second = value;
+        s.hash = hash;
+        s.used = true;
+        m_cnt++;
+    }
+
+    void rehash(size_t cap) {
+        std::vector<slot_t> old(cap);
+        old.swap(m_slots);
+        m_cnt = 0;
+        for (auto& s : old) {
+            if (s.used) {
+                place(s.first, s.second, s.hash);
+            }
+        }
+    }
+
+   private:
+    std::vector<slot_t> m_slots;
+    size_t m_cnt = 0;
+    H m_hash;
+    E m_equal;
+};
+
+/* fds are small and dense, fd is the index of array. */
+template <typename T>
+class FdTable {
+   public:
+    T* get(int fd) const {
+        return (fd >= 0 && (size_t)fd < m_items.size()) ? m_items[fd] : nullptr;
+    }
+
+    bool set(int fd, T* item) {
+        if (fd < 0 || item == nullptr) {
+            return false;
+        }
+        if ((size_t)fd >= m_items.size()) {
+            m_items.resize(fd + 1024, nullptr);
+        }
+        if (m_items[fd] == nullptr) {
+            m_cnt++;
+        }
+        m_items[fd] = item;
+        return true;
+    }
+
+    T* remove(int fd) {
+        T* item = get(fd);
+        if (item != nullptr) {
+            m_items[fd] = nullptr;
+            m_cnt--;
+        }
+        return item;
+    }
+
+    size_t size() const { return m_cnt; }
+
+    /* walk by index, items can be removed in fn. */
+    template <typename F>
+    void for_each(F fn) {
+        for (size_t i = 0; i < m_items.size(); i++) {
+            if (m_items[i] != nullptr) {
+                fn(m_items[i]);
+            }
+        }
+    }
+
+   private:
+    std::vector<T*> m_items;
+    size_t m_cnt = 0;
+};
+
+}  // namespace kim
+
+#endif  //__KIM_FLAT_MAP_H__
@@ -1,17 +1,51 @@
 #include "log.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <string.h>
 #include <strings.h>
-#include <sys/time.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
-#include "log.h"
+#include "clock.h"
+#include "log_bin.h"
 
 namespace kim {
 
 #define LOG_MAX_LEN 1024
+#define LOG_FLUSH_BUF_LEN (64 * 1024)  /* flush thread writes in batch. */
+#define LOG_FLUSH_WAIT_MS 100          /* flush thread sleeps when ring is empty. */
+#define LOG_ROTATE_CHECK_SECS 1        /* check rotation per second. */
+
+static const char g_levels[][10] = {"EMRG", "ALRT", "CRIT", "ERRO", "WARN", "NOTI", "INFO", "DBUG", "TRAC"};
+
+/* increased in forked child, the async ring's flush thread is not there,
+ * and its mutex may be copied while it is locked. */
+static std::atomic<uint32_t> g_fork_cnt{0};
+static pthread_once_t g_atfork_once = PTHREAD_ONCE_INIT;
+
+static void on_fork_child() {
+    g_fork_cnt.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void register_atfork() {
+    pthread_atfork(nullptr, nullptr, on_fork_child);
+}
+
+/* every logger has its own site ids, call site's cache tells them apart. */
+static std::atomic<uint32_t> g_site_tag{0};
 
 Log::Log() : m_cur_level(LL_TRACE) {
+    pthread_mutex_init(&m_site_mutex, NULL);
+    m_site_tag = g_site_tag.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+Log::~Log() {
+    stop_async();
+    pthread_mutex_destroy(&m_site_mutex);
 }
 
 bool Log::set_log_path(const char* path) {
@@ -68,17 +102,166 @@ bool Log::set_level(const char* level) {
     return true;
 }
 
-bool Log::log_data(const char* file_name, int file_line,
-                   const char* func_name, int level, const char* fmt, ...) {
-    if (level < LL_EMERG || level >= LL_COUNT || level > m_cur_level) {
+bool Log::set_full_policy(const char* policy) {
+    if (policy == nullptr || *policy == '\0' || strcasecmp(policy, "drop") == 0) {
+        m_full_policy = FULL_POLICY::DROP;
+    } else if (strcasecmp(policy, "block") == 0) {
+        m_full_policy = FULL_POLICY::BLOCK;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool Log::set_format(const char* format) {
+    if (format == nullptr || *format == '\0' || strcasecmp(format, "text") == 0) {
+        m_is_binary = false;
+    } else if (strcasecmp(format, "binary") == 0) {
+        m_is_binary = true;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void Log::set_rotate(size_t size, int interval) {
+    m_rotate_size = size;
+    m_rotate_interval = (interval > 0) ? interval : 0;
+    if (m_rotate_interval > 0) {
+        m_rotate_period = (long long)time(nullptr) / m_rotate_interval;
+    }
+}
+
+bool Log::set_async(size_t ring_cnt) {
+    if (m_ring != nullptr || ring_cnt == 0 || (ring_cnt & (ring_cnt - 1)) != 0) {
+        return false;
+    }
+
+    if (!open_fd()) {
+        return false;
+    }
+
+    m_ring = new log_slot_t[ring_cnt];
+    for (size_t i = 0; i < ring_cnt; i++) {
+        m_ring[i].seq.store(i, std::memory_order_relaxed);
+        m_ring[i].len = 0;
+    }
+    m_ring_mask = ring_cnt - 1;
+    m_enqueue_pos.store(0, std::memory_order_relaxed);
+    m_dequeue_pos = 0;
+    m_stop_thread = false;
+
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_cond, NULL);
+    if (pthread_create(&m_thread, NULL, flush_thread, this) != 0) {
+        pthread_mutex_destroy(&m_mutex);
+        pthread_cond_destroy(&m_cond);
+        delete[] m_ring;
+        m_ring = nullptr;
+        return false;
+    }
+    m_thread_pid = getpid();
+    pthread_once(&g_atfork_once, register_atfork);
+    m_fork_cnt = g_fork_cnt.load(std::memory_order_relaxed);
+    return true;
+}
+
+bool Log::is_async() const {
+    return m_ring != nullptr && m_fork_cnt == g_fork_cnt.load(std::memory_order_relaxed);
+}
+
+void Log::stop_async() {
+    if (m_ring == nullptr) {
+        return;
+    }
+
+    /* the logger may be deleted by forked child, and the thread
+     * does not exist in child, the lines in ring belong to parent. */
+    if (m_thread_pid == getpid()) {
+        pthread_mutex_lock(&m_mutex);
+        m_stop_thread = true;
+        pthread_cond_signal(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+        pthread_join(m_thread, NULL);
+        pthread_mutex_destroy(&m_mutex);
+        pthread_cond_destroy(&m_cond);
+    }
+
+    delete[] m_ring;
+    m_ring = nullptr;
+
+    if (m_fd != -1 && m_fd != STDOUT_FILENO) {
+        close(m_fd);
+    }
+    m_fd = -1;
+}
+
+bool Log::open_fd() {
+    if (m_path.empty()) {
+        m_fd = STDOUT_FILENO;
+        return true;
+    }
+
+    int fd = open(m_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) {
         return false;
     }
+    if (m_fd != -1 && m_fd != STDOUT_FILENO) {
+        close(m_fd);
+    }
+    m_fd = fd;
+
+    /* new file, it needs the sites to decode. */
+    if (m_is_binary) {
+        write_sites();
+    }
+    return true;
+}
+
+int Log::format_header(char* buf, int size, const char* file_name,
+                       int file_line, const char* func_name, int level) {
+    return snprintf(buf, size, "[%s][%s%d][%d]%s[%s:%s:%d] ",
+                    g_levels[level], m_is_manager ? "M" : "W", m_worker_index, (int)getpid(),
+                    Clock::timestamp(), file_name, func_name, file_line);
+}
+
+bool Log::log_data(const char* file_name, int file_line,
+                   const char* func_name, int level, const char* fmt, ...) {
+    bool ret;
+    va_list ap;
+    va_start(ap, fmt);
+    ret = log_va(nullptr, file_name, file_line, func_name, level, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+bool Log::log_data(std::atomic<uint64_t>* site, const char* file_name, int file_line,
+                   const char* func_name, int level, const char* fmt, ...) {
+    bool ret;
     va_list ap;
-    char msg[LOG_MAX_LEN] = {0};
     va_start(ap, fmt);
-    vsnprintf(msg, sizeof(msg), fmt, ap);
+    ret = log_va(site, file_name, file_line, func_name, level, fmt, ap);
     va_end(ap);
-    return log_raw(file_name, file_line, func_name, level, msg);
+    return ret;
+}
+
+bool Log::log_va(std::atomic<uint64_t>* site, const char* file_name, int file_line,
+                 const char* func_name, int level, const char* fmt, va_list ap) {
+    if (level < LL_EMERG || level >= LL_COUNT || level > m_cur_level) {
+        return false;
+    }
+
+    bool ret;
+    if (m_is_binary) {
+        ret = log_binary(site, file_name, file_line, func_name, level, fmt, ap);
+    } else if (is_async()) {
+        ret = log_async(file_name, file_line, func_name, level, fmt, ap);
+    } else {
+        char msg[LOG_MAX_LEN] = {0};
+        vsnprintf(msg, sizeof(msg), fmt, ap);
+        ret = log_raw(file_name, file_line, func_name, level, msg);
+    }
+    return ret;
 }
 
 bool Log::log_raw(const char* file_name, int file_line,
@@ -92,19 +275,9 @@ bool Log::log_raw(const char* file_name, int file_line,
     }
     is_log_file = !m_path.empty();
 
-    int off;
-    char buf[64] = {0};
-    struct timeval tv;
-    char levels[][10] = {"EMRG", "ALRT", "CRIT", "ERRO", "WARN", "NOTI", "INFO", "DBUG", "TRAC"};
-
-    time_t t = time(NULL);
-    struct tm* tm = localtime(&t);
-    gettimeofday(&tv, NULL);
-    off = strftime(buf, sizeof(buf), "[%Y-%m-%d %H:%M:%S.", tm);
-    snprintf(buf + off, sizeof(buf) - off, "%03d]", (int)tv.tv_usec / 1000);
     fprintf(fp, "[%s][%s%d][%d]%s[%s:%s:%d] %s\n",
-            levels[level], m_is_manager ? "M" : "W", m_worker_index, (int)getpid(),
-            buf, file_name, func_name, file_line, msg);
+            g_levels[level], m_is_manager ? "M" : "W", m_worker_index, (int)getpid(),
+            Clock::timestamp(), file_name, func_name, file_line, msg);
 
     fflush(fp);
     if (is_log_file) {
@@ -113,4 +286,406 @@ bool Log::log_raw(const char* file_name, int file_line,
     return true;
 }
 
+bool Log::log_async(const char* file_name, int file_line, const char* func_name,
+                    int level, const char* fmt, va_list ap) {
+    int len, n;
+    log_slot_t* slot;
+
+    slot = claim_slot();
+    if (slot == nullptr) {
+        m_drop_cnt.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /* format in place, keep the last byte for '\n'. */
+    len = format_header(slot->data, ASYNC_SLOT_LEN - 1, file_name, file_line, func_name, level);
+    if (len < 0) {
+        len = 0;
+    } else if (len > ASYNC_SLOT_LEN - 2) {
+        len = ASYNC_SLOT_LEN - 2;
+    }
+
+    n = vsnprintf(slot->data + len, ASYNC_SLOT_LEN - 1 - len, fmt, ap);
+    if (n > 0) {
+        len += (n < ASYNC_SLOT_LEN - 1 - len) ? n : ASYNC_SLOT_LEN - 2 - len;
+    }
+    slot->data[len++] = '\n';
+    slot->len = len;
+
+    commit_slot(slot);
+    return true;
+}
+
+bool Log::log_binary(std::atomic<uint64_t>* site, const char* file_name, int file_line,
+                     const char* func_name, int level, const char* fmt, va_list ap) {
+    int len;
+    uint64_t v;
+    uint32_t id = 0;
+    log_slot_t* slot = nullptr;
+    char data[ASYNC_SLOT_LEN];
+
+    /* fast path: call site has been registered by this logger, no lock. */
+    if (site != nullptr) {
+        v = site->load(std::memory_order_acquire);
+        if ((uint32_t)(v >> 32) == m_site_tag) {
+            id = (uint32_t)v;
+        }
+    }
+
+    if (id == 0) {
+        id = add_site(site, file_name, file_line, func_name, fmt);
+        if (id == 0) {
+            return false;
+        }
+    }
+
+    if (is_async()) {
+        slot = claim_slot();
+        if (slot == nullptr) {
+            m_drop_cnt.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    char* buf = (slot != nullptr) ? slot->data : data;
+    len = sizeof(log_bin_head_t);
+    len += log_bin_encode_args(buf + len, ASYNC_SLOT_LEN - len, fmt, ap);
+    fill_bin_head(buf, LOG_BIN_MSG, level, id, len);
+
+    if (slot != nullptr) {
+        slot->len = len;
+        commit_slot(slot);
+        return true;
+    }
+    return write_file(data, len);
+}
+
+uint32_t Log::add_site(std::atomic<uint64_t>* site, const char* file_name, int file_line,
+                       const char* func_name, const char* fmt) {
+    int len;
+    uint64_t v;
+    uint32_t id = 0;
+    log_slot_t* slot = nullptr;
+    char data[ASYNC_SLOT_LEN];
+
+    /* claim site's slot before locking, flush thread may wait for the lock. */
+    if (is_async()) {
+        slot = claim_slot();
+        if (slot == nullptr) {
+            m_drop_cnt.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+    }
+
+    pthread_mutex_lock(&m_site_mutex);
+
+    /* other thread may have registered it. */
+    if (site != nullptr) {
+        v = site->load(std::memory_order_acquire);
+        if ((uint32_t)(v >> 32) == m_site_tag) {
+            id = (uint32_t)v;
+        }
+    } else {
+        /* fmt's address may be reused by a reloaded module, check its content. */
+        auto it = m_site_ids.find(std::make_pair(fmt, file_line));
+        if (it != m_site_ids.end() && m_sites[it->second - 1].fmt == fmt) {
+            id = it->second;
+        }
+    }
+
+    if (id != 0 && slot == nullptr) {
+        pthread_mutex_unlock(&m_site_mutex);
+        return id;
+    }
+
+    if (id == 0) {
+        m_sites.push_back({file_name, func_name, fmt, file_line});
+        id = (uint32_t)m_sites.size();
+    }
+
+    /* site's record goes first, then its id is visible to other threads.
+     * a claimed slot must be committed, a duplicated site record is harmless. */
+    if (slot != nullptr) {
+        slot->len = encode_site(slot->data, ASYNC_SLOT_LEN, id, m_sites[id - 1]);
+        commit_slot(slot);
+    } else {
+        len = encode_site(data, sizeof(data), id, m_sites[id - 1]);
+        if (!write_file(data, len)) {
+            m_sites.pop_back();
+            pthread_mutex_unlock(&m_site_mutex);
+            return 0;
+        }
+    }
+
+    if (site != nullptr) {
+        site->store(((uint64_t)m_site_tag << 32) | id, std::memory_order_release);
+    } else {
+        m_site_ids[std::make_pair(fmt, file_line)] = id;
+    }
+
+    pthread_mutex_unlock(&m_site_mutex);
+    return id;
+}
+
+bool Log::write_file(const char* data, size_t len) {
+    FILE* fp = m_path.empty() ? stdout : fopen(m_path.c_str(), "ab");
+    if (fp == nullptr) {
+        return false;
+    }
+    fwrite(data, 1, len, fp);
+    fflush(fp);
+    if (!m_path.empty()) {
+        fclose(fp);
+    }
+    return true;
+}
+
+int Log::encode_site(char* buf, size_t size, uint32_t id, const log_site_t& site) {
+    size_t len;
+    uint32_t line = site.line;
+    const std::string* strs[] = {&site.file, &site.func, &site.fmt};
+
+    len = sizeof(log_bin_head_t);
+    memcpy(buf + len, &line, sizeof(line));
+    len += sizeof(line);
+
+    for (auto s : strs) {
+        size_t n = s->size();
+        if (len + n + 1 > size) {
+            n = (size > len + 1) ? size - len - 1 : 0;
+        }
+        memcpy(buf + len, s->c_str(), n);
+        len += n;
+        buf[len++] = '\0';
+    }
+
+    fill_bin_head(buf, LOG_BIN_SITE, LL_INFO, id, len);
+    return (int)len;
+}
+
+void Log::fill_bin_head(char* buf, int type, int level, uint32_t site_id, uint32_t len) {
+    log_bin_head_t head;
+    memset(&head, 0, sizeof(head));
+    head.magic = LOG_BIN_MAGIC;
+    head.type = (uint8_t)type;
+    head.level = (uint8_t)level;
+    head.len = len;
+    head.pid = (int32_t)getpid();
+    head.worker_index = (int16_t)m_worker_index;
+    head.is_manager = m_is_manager ? 1 : 0;
+    head.site_id = site_id;
+    head.time_ms = (int64_t)(Clock::wall_time() * 1000);
+    memcpy(buf, &head, sizeof(head));
+}
+
+void Log::write_sites() {
+    int len;
+    char buf[ASYNC_SLOT_LEN];
+    std::vector<log_site_t> sites;
+
+    pthread_mutex_lock(&m_site_mutex);
+    sites = m_sites;
+    pthread_mutex_unlock(&m_site_mutex);
+
+    for (size_t i = 0; i < sites.size(); i++) {
+        len = encode_site(buf, sizeof(buf), (uint32_t)(i + 1), sites[i]);
+        write_fd(buf, len);
+    }
+}
+
+Log::log_slot_t* Log::claim_slot() {
+    int64_t diff;
+    uint64_t pos, seq;
+    log_slot_t* slot;
+
+    pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        slot = &m_ring[pos & m_ring_mask];
+        seq = slot->seq.load(std::memory_order_acquire);
+        diff = (int64_t)seq - (int64_t)pos;
+        if (diff == 0) {
+            if (m_enqueue_pos.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed)) {
+                return slot;
+            }
+        } else if (diff < 0) {
+            /* full. */
+            if (m_full_policy == FULL_POLICY::DROP) {
+                return nullptr;
+            }
+            pthread_cond_signal(&m_cond);
+            sched_yield();
+            pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        } else {
+            pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Log::commit_slot(log_slot_t* slot) {
+    uint64_t pos = slot->seq.load(std::memory_order_relaxed);
+    slot->seq.store(pos + 1, std::memory_order_release);
+
+    /* wake up flush thread, only when it sleeps. */
+    if (m_sleeping.load(std::memory_order_acquire)) {
+        pthread_mutex_lock(&m_mutex);
+        pthread_cond_signal(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+    }
+}
+
+size_t Log::flush_ring(char* buf, size_t size) {
+    size_t len = 0, cnt = 0;
+    log_slot_t* slot;
+    uint64_t drop_cnt;
+
+    drop_cnt = m_drop_cnt.load(std::memory_order_relaxed);
+    if (drop_cnt != m_drop_reported) {
+        if (m_is_binary) {
+            len = sizeof(log_bin_head_t);
+            len += snprintf(buf + len, size - len, "log ring is full, drop lines: %llu",
+                            (unsigned long long)(drop_cnt - m_drop_reported));
+            fill_bin_head(buf, LOG_BIN_TEXT, LL_WARNING, 0, len);
+        } else {
+            len = snprintf(buf, size, "[%s][%s%d][%d]%s log ring is full, drop lines: %llu\n",
+                           g_levels[LL_WARNING], m_is_manager ? "M" : "W", m_worker_index,
+                           (int)getpid(), Clock::timestamp(),
+                           (unsigned long long)(drop_cnt - m_drop_reported));
+        }
+        m_drop_reported = drop_cnt;
+    }
+
+    for (;;) {
+        slot = &m_ring[m_dequeue_pos & m_ring_mask];
+        if (slot->seq.load(std::memory_order_acquire) != m_dequeue_pos + 1) {
+            break; /* empty, or producer is still formatting it. */
+        }
+
+        if (len + slot->len > size) {
+            write_fd(buf, len);
+            len = 0;
+        }
+        memcpy(buf + len, slot->data, slot->len);
+        len += slot->len;
+        cnt++;
+
+        slot->seq.store(m_dequeue_pos + m_ring_mask + 1, std::memory_order_release);
+        m_dequeue_pos++;
+    }
+
+    if (len > 0) {
+        write_fd(buf, len);
+    }
+    return cnt;
+}
+
+bool Log::write_fd(const char* data, size_t len) {
+    ssize_t n;
+
+    while (len > 0) {
+        n = write(m_fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+void Log::check_rotate() {
+    long long now;
+    struct stat st, fst;
+    bool rotate = false;
+
+    if (m_path.empty()) {
+        return;
+    }
+
+    now = (long long)time(nullptr);
+    if (now - m_last_check < LOG_ROTATE_CHECK_SECS) {
+        return;
+    }
+    m_last_check = now;
+
+    if (m_is_manager && (m_rotate_size > 0 || m_rotate_interval > 0)) {
+        if (m_rotate_size > 0 && fstat(m_fd, &fst) == 0 &&
+            (size_t)fst.st_size >= m_rotate_size) {
+            rotate = true;
+        }
+        if (m_rotate_interval > 0 && now / m_rotate_interval != m_rotate_period) {
+            m_rotate_period = now / m_rotate_interval;
+            rotate = true;
+        }
+
+        if (rotate) {
+            char path[512], tm_str[32];
+            time_t t = (time_t)now;
+            struct tm tm;
+            localtime_r(&t, &tm);
+            strftime(tm_str, sizeof(tm_str), "%Y%m%d-%H%M%S", &tm);
+            snprintf(path, sizeof(path), "%s.%s", m_path.c_str(), tm_str);
+            if (rename(m_path.c_str(), path) == 0) {
+                open_fd();
+            }
+            return;
+        }
+    }
+
+    /* file was rotated (by manager) or removed, reopen it. */
+    if (stat(m_path.c_str(), &st) != 0 ||
+        (fstat(m_fd, &fst) == 0 && (st.st_ino != fst.st_ino || st.st_dev != fst.st_dev))) {
+        open_fd();
+    }
+}
+
+void* Log::flush_thread(void* arg) {
+    Log* log = (Log*)arg;
+    char* buf;
+    sigset_t sigset;
+    struct timespec ts;
+
+    /* signals are handled by main thread. */
+    sigfillset(&sigset);
+    pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+
+    buf = (char*)malloc(LOG_FLUSH_BUF_LEN);
+    if (buf == nullptr) {
+        return nullptr;
+    }
+
+    for (;;) {
+        if (log->flush_ring(buf, LOG_FLUSH_BUF_LEN) > 0) {
+            log->check_rotate();
+            continue;
+        }
+
+        pthread_mutex_lock(&log->m_mutex);
+        if (log->m_stop_thread) {
+            pthread_mutex_unlock(&log->m_mutex);
+            /* lines logged before stop. */
+            log->flush_ring(buf, LOG_FLUSH_BUF_LEN);
+            break;
+        }
+        log->m_sleeping.store(true, std::memory_order_release);
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += LOG_FLUSH_WAIT_MS * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&log->m_cond, &log->m_mutex, &ts);
+        log->m_sleeping.store(false, std::memory_order_release);
+        pthread_mutex_unlock(&log->m_mutex);
+
+        log->check_rotate();
+    }
+
+    free(buf);
+    return nullptr;
+}
+
 }  // namespace kim
\ No newline at end of file
@@ -1,13 +1,25 @@
 #ifndef __KIM_LOG_H__
 #define __KIM_LOG_H__
 
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <sys/types.h>
 
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <vector>
 
 namespace kim {
 
+/* log levels above it are compiled out by logger macros,
+ * like: make LOG_COMPILE_LEVEL=6 (info). */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL (kim::Log::LL_TRACE)
+#endif
+
 class Log {
    public:
     enum {
@@ -23,26 +35,130 @@ class Log {
         LL_COUNT
     };
 
+    /* what to do when async ring is full. */
+    enum class FULL_POLICY {
+        DROP = 0, /* drop the line, and count it. */
+        BLOCK,    /* wait for the flush thread. */
+    };
+
+    enum {
+        ASYNC_RING_CNT = 4096, /* default slots of async ring, power of 2. */
+        ASYNC_SLOT_LEN = 1536, /* max len of one formatted line. */
+    };
+
     Log();
-    virtual ~Log() {}
+    virtual ~Log();
 
    public:
     bool set_level(int level);
     bool set_level(const char* level);
     bool set_log_path(const char* path);
+    /* cheap check for logger macro, before formatting. */
+    bool is_level_enabled(int level) const { return level <= m_cur_level; }
     bool log_data(const char* file_name,
                   int file_line, const char* func_name, int level, const char* fmt, ...);
+    /* site: call site's static cache of binary log site id, see LOG_FORMAT. */
+    bool log_data(std::atomic<uint64_t>* site, const char* file_name,
+                  int file_line, const char* func_name, int level, const char* fmt, ...);
 
     void set_worker_index(int index) { m_worker_index = index; }
     void set_process_type(bool is_manager) { m_is_manager = is_manager; }
 
+    /* async mode: lines are formatted into a lock-free ring,
+     * and a background thread writes them in batch to the file.
+     * call it after set_log_path, in the process which logs. */
+    bool set_async(size_t ring_cnt = ASYNC_RING_CNT);
+    /* "drop" (default) or "block". */
+    bool set_full_policy(const char* policy);
+    /* rotate log file by size (bytes) or by time (seconds), 0: disabled.
+     * only manager renames the file, workers reopen it when it changes. */
+    void set_rotate(size_t size, int interval);
+    /* forked child writes synchronously, its ring has no flush thread. */
+    bool is_async() const;
+    uint64_t drop_cnt() const { return m_drop_cnt.load(std::memory_order_relaxed); }
+    /* "text" (default) or "binary", binary log is decoded by tool kimlog. */
+    bool set_format(const char* format);
+    bool is_binary() const { return m_is_binary; }
+
    private:
+    bool log_va(std::atomic<uint64_t>* site, const char* file_name, int file_line,
+                const char* func_name, int level, const char* fmt, va_list ap);
     bool log_raw(const char* file_name, int file_line, const char* func_name, int level, const char* msg);
+    int format_header(char* buf, int size, const char* file_name, int file_line,
+                      const char* func_name, int level);
+
+    /* binary. */
+    typedef struct log_site_s {
+        std::string file;
+        std::string func;
+        std::string fmt;
+        int line;
+    } log_site_t;
+
+    bool log_binary(std::atomic<uint64_t>* site, const char* file_name, int file_line,
+                    const char* func_name, int level, const char* fmt, va_list ap);
+    /* register the site and write its record, returns 0 if it fails. */
+    uint32_t add_site(std::atomic<uint64_t>* site, const char* file_name, int file_line,
+                      const char* func_name, const char* fmt);
+    bool write_file(const char* data, size_t len);
+    int encode_site(char* buf, size_t size, uint32_t id, const log_site_t& site);
+    void fill_bin_head(char* buf, int type, int level, uint32_t site_id, uint32_t len);
+    void write_sites();
+
+    /* async. */
+    typedef struct log_slot_s {
+        std::atomic<uint64_t> seq;
+        uint32_t len;
+        char data[ASYNC_SLOT_LEN];
+    } log_slot_t;
+
+    bool log_async(const char* file_name, int file_line, const char* func_name,
+                   int level, const char* fmt, va_list ap);
+    log_slot_t* claim_slot();
+    void commit_slot(log_slot_t* slot);
+    void stop_async();
+    static void* flush_thread(void* arg);
+    size_t flush_ring(char* buf, size_t size);
+    bool write_fd(const char* data, size_t len);
+    bool open_fd();
+    void check_rotate();
 
    private:
     int m_cur_level;
     std::string m_path;
 
+    /* async ring, multi producers (main thread, zk thread...), one consumer. */
+    log_slot_t* m_ring = nullptr;
+    size_t m_ring_mask = 0;
+    std::atomic<uint64_t> m_enqueue_pos{0};
+    uint64_t m_dequeue_pos = 0; /* only flush thread touches it. */
+    std::atomic<uint64_t> m_drop_cnt{0};
+    uint64_t m_drop_reported = 0;
+    FULL_POLICY m_full_policy = FULL_POLICY::DROP;
+
+    /* flush thread. */
+    pthread_t m_thread;
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_cond;
+    std::atomic<bool> m_sleeping{false};
+    volatile bool m_stop_thread = false;
+    pid_t m_thread_pid = -1; /* threads do not survive fork. */
+    uint32_t m_fork_cnt = 0; /* forks of process when the thread is created. */
+
+    /* file stays open in async mode. */
+    int m_fd = -1;
+    size_t m_rotate_size = 0;
+    int m_rotate_interval = 0;
+    long long m_rotate_period = 0;
+    long long m_last_check = 0;
+
+    /* binary format, sites are written again to the new file. */
+    bool m_is_binary = false;
+    uint32_t m_site_tag = 0; /* call site's cache: (tag << 32) | site id. */
+    pthread_mutex_t m_site_mutex;
+    std::map<std::pair<const char*, int>, uint32_t> m_site_ids; /* call sites without cache. */
+    std::vector<log_site_t> m_sites;                            /* index + 1: site id. */
+
     /* process info. */
     int m_worker_index = -1;
     bool m_is_manager = false;
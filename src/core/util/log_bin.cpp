@@ -0,0 +1,362 @@
+#include "log_bin.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+namespace kim {
+
+/* argument's type of printf conversion. */
+enum class ARG {
+    NONE = 0, /* "%%" or invalid. */
+    INT,
+    LONG,
+    LLONG,
+    SIZE,
+    PTRDIFF,
+    INTMAX,
+    DOUBLE,
+    LDOUBLE,
+    STR,
+    PTR,
+    COUNT, /* "%n", not supported, its argument is skipped. */
+};
+
+typedef struct fmt_spec_s {
+    const char* begin; /* begins with '%'. */
+    size_t len;
+    int stars; /* '*' width or precision. */
+    bool has_prec;
+    bool is_prec_star;
+    int prec;
+    ARG type;
+} fmt_spec_t;
+
+/* parse the conversion which begins with '%', return the next position. */
+static const char* parse_spec(const char* p, fmt_spec_t& spec) {
+    const char* q = p + 1;
+    int len_mod = 0; /* 'h', 'l', 'L', 'j', 'z', 't', "ll": 'q'. */
+
+    memset(&spec, 0, sizeof(spec));
+    spec.begin = p;
+    spec.type = ARG::NONE;
+
+    if (*q == '%') {
+        spec.len = 2;
+        return q + 1;
+    }
+
+    while (*q != '\0' && strchr("-+ #0'", *q) != nullptr) q++;
+    if (*q == '*') {
+        spec.stars++;
+        q++;
+    } else {
+        while (*q >= '0' && *q <= '9') q++;
+    }
+
+    if (*q == '.') {
+        q++;
+        spec.has_prec = true;
+        if (*q == '*') {
+            spec.stars++;
+            spec.is_prec_star = true;
+            q++;
+        } else {
+            while (*q >= '0' && *q <= '9') {
+                spec.prec = spec.prec * 10 + (*q++ - '0');
+            }
+        }
+    }
+
+    if (*q == 'h') {
+        len_mod = 'h';
+        q += (q[1] == 'h') ? 2 : 1;
+    } else if (*q == 'l') {
+        len_mod = (q[1] == 'l') ? 'q' : 'l';
+        q += (q[1] == 'l') ? 2 : 1;
+    } else if (*q == 'q') {
+        len_mod = 'q';
+        q++;
+    } else if (*q == 'Z') {
+        len_mod = 'z';
+        q++;
+    } else if (*q != '\0' && strchr("Ljzt", *q) != nullptr) {
+        len_mod = *q++;
+    }
+
+    switch (*q) {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            switch (len_mod) {
+                case 'l': spec.type = ARG::LONG; break;
+                case 'q': spec.type = ARG::LLONG; break;
+                case 'j': spec.type = ARG::INTMAX; break;
+                case 'z': spec.type = ARG::SIZE; break;
+                case 't': spec.type = ARG::PTRDIFF; break;
+                default: spec.type = ARG::INT; break;
+            }
+            break;
+        case 'c':
+            spec.type = ARG::INT;
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            spec.type = (len_mod == 'L') ? ARG::LDOUBLE : ARG::DOUBLE;
+            break;
+        case 's':
+            /* wide string is not supported, log its address. */
+            spec.type = (len_mod == 'l') ? ARG::PTR : ARG::STR;
+            break;
+        case 'p':
+            spec.type = ARG::PTR;
+            break;
+        case 'n':
+            spec.type = ARG::COUNT;
+            break;
+        default:
+            /* invalid conversion, output as it is. */
+            spec.stars = 0;
+            spec.len = q - p;
+            return q;
+    }
+
+    q++;
+    spec.len = q - p;
+    return q;
+}
+
+static bool put_int(char*& p, const char* end, int64_t v) {
+    if (end - p < (ptrdiff_t)sizeof(v)) {
+        return false;
+    }
+    memcpy(p, &v, sizeof(v));
+    p += sizeof(v);
+    return true;
+}
+
+int log_bin_encode_args(char* buf, size_t size, const char* fmt, va_list ap) {
+    int prec;
+    double d;
+    size_t len;
+    fmt_spec_t spec;
+    const char* s;
+    char* p = buf;
+    const char* end = buf + size;
+
+    while (*fmt != '\0') {
+        if (*fmt != '%') {
+            fmt++;
+            continue;
+        }
+
+        fmt = parse_spec(fmt, spec);
+        if (spec.type == ARG::NONE) {
+            continue;
+        }
+
+        prec = spec.prec;
+        for (int i = 0; i < spec.stars; i++) {
+            int v = va_arg(ap, int);
+            if (!put_int(p, end, v)) return p - buf;
+            if (spec.is_prec_star && i == spec.stars - 1) {
+                prec = v;
+            }
+        }
+
+        switch (spec.type) {
+            case ARG::INT:
+                if (!put_int(p, end, va_arg(ap, int))) return p - buf;
+                break;
+            case ARG::LONG:
+                if (!put_int(p, end, va_arg(ap, long))) return p - buf;
+                break;
+            case ARG::LLONG:
+                if (!put_int(p, end, va_arg(ap, long long))) return p - buf;
+                break;
+            case ARG::SIZE:
+                if (!put_int(p, end, (int64_t)va_arg(ap, size_t))) return p - buf;
+                break;
+            case ARG::PTRDIFF:
+                if (!put_int(p, end, va_arg(ap, ptrdiff_t))) return p - buf;
+                break;
+            case ARG::INTMAX:
+                if (!put_int(p, end, va_arg(ap, intmax_t))) return p - buf;
+                break;
+            case ARG::PTR:
+                if (!put_int(p, end, (int64_t)(uintptr_t)va_arg(ap, void*))) return p - buf;
+                break;
+            case ARG::DOUBLE:
+            case ARG::LDOUBLE:
+                d = (spec.type == ARG::DOUBLE) ? va_arg(ap, double) : (double)va_arg(ap, long double);
+                if (end - p < (ptrdiff_t)sizeof(d)) return p - buf;
+                memcpy(p, &d, sizeof(d));
+                p += sizeof(d);
+                break;
+            case ARG::STR: {
+                uint32_t n;
+                s = va_arg(ap, const char*);
+                if (s == nullptr) {
+                    s = "(null)";
+                }
+                /* "%.*s" may point to the bytes without '\0'. */
+                len = (spec.has_prec && prec >= 0) ? strnlen(s, prec) : strlen(s);
+                if (end - p < (ptrdiff_t)sizeof(n)) return p - buf;
+                if (len > (size_t)(end - p) - sizeof(n)) {
+                    len = (end - p) - sizeof(n);
+                }
+                n = (uint32_t)len;
+                memcpy(p, &n, sizeof(n));
+                memcpy(p + sizeof(n), s, len);
+                p += sizeof(n) + len;
+                break;
+            }
+            case ARG::COUNT:
+                (void)va_arg(ap, void*);
+                break;
+            default:
+                break;
+        }
+    }
+
+    return p - buf;
+}
+
+template <typename T>
+static void append_arg(std::string& out, const std::string& spec, int stars, const int* sv, T v) {
+    int n;
+    char buf[256];
+
+    switch (stars) {
+        case 0: n = snprintf(buf, sizeof(buf), spec.c_str(), v); break;
+        case 1: n = snprintf(buf, sizeof(buf), spec.c_str(), sv[0], v); break;
+        default: n = snprintf(buf, sizeof(buf), spec.c_str(), sv[0], sv[1], v); break;
+    }
+
+    if (n < 0) {
+        return;
+    } else if (n < (int)sizeof(buf)) {
+        out.append(buf, n);
+        return;
+    }
+
+    std::vector<char> big(n + 1);
+    switch (stars) {
+        case 0: n = snprintf(&big[0], big.size(), spec.c_str(), v); break;
+        case 1: n = snprintf(&big[0], big.size(), spec.c_str(), sv[0], v); break;
+        default: n = snprintf(&big[0], big.size(), spec.c_str(), sv[0], sv[1], v); break;
+    }
+    if (n > 0) {
+        out.append(&big[0], n);
+    }
+}
+
+bool log_bin_decode_args(const char* fmt, const char* data, size_t len, std::string& out) {
+    int64_t v;
+    double d;
+    uint32_t n;
+    int sv[2] = {0};
+    fmt_spec_t spec;
+    const char* p = data;
+    const char* end = data + len;
+
+#define GET_BYTES(dst, size)           \
+    if (end - p < (ptrdiff_t)(size)) { \
+        out.append("?");               \
+        return false;                  \
+    }                                  \
+    memcpy(dst, p, size);              \
+    p += size;
+
+    while (*fmt != '\0') {
+        if (*fmt != '%') {
+            const char* next = strchr(fmt, '%');
+            size_t cnt = (next != nullptr) ? (size_t)(next - fmt) : strlen(fmt);
+            out.append(fmt, cnt);
+            fmt += cnt;
+            continue;
+        }
+
+        fmt = parse_spec(fmt, spec);
+        if (spec.type == ARG::NONE) {
+            out.append((spec.len == 2 && spec.begin[1] == '%') ? "%" : std::string(spec.begin, spec.len));
+            continue;
+        }
+
+        for (int i = 0; i < spec.stars && i < 2; i++) {
+            GET_BYTES(&v, sizeof(v));
+            sv[i] = (int)v;
+        }
+
+        std::string sp(spec.begin, spec.len);
+        switch (spec.type) {
+            case ARG::INT:
+                GET_BYTES(&v, sizeof(v));
+                append_arg(out, sp, spec.stars, sv, (int)v);
+                break;
+            case ARG::LONG:
+                GET_BYTES(&v, sizeof(v));
+                append_arg(out, sp, spec.stars, sv, (long)v);
+                break;
+            case ARG::LLONG:
+                GET_BYTES(&v, sizeof(v));
+                append_arg(out, sp, spec.stars, sv, (long long)v);
+                break;
+            case ARG::SIZE:
+                GET_BYTES(&v, sizeof(v));
+                append_arg(out, sp, spec.stars, sv, (size_t)v);
+                break;
+            case ARG::PTRDIFF:
+                GET_BYTES(&v, sizeof(v));
+                append_arg(out, sp, spec.stars, sv, (ptrdiff_t)v);
+                break;
+            case ARG::INTMAX:
+                GET_BYTES(&v, sizeof(v));
+                append_arg(out, sp, spec.stars, sv, (intmax_t)v);
+                break;
+            case ARG::PTR:
+                GET_BYTES(&v, sizeof(v));
+                if (sp.back() == 's') {
+                    sp.replace(sp.size() - 2, 2, "p"); /* "%ls" was logged as address. */
+                }
+                append_arg(out, sp, spec.stars, sv, (void*)(uintptr_t)v);
+                break;
+            case ARG::DOUBLE:
+                GET_BYTES(&d, sizeof(d));
+                append_arg(out, sp, spec.stars, sv, d);
+                break;
+            case ARG::LDOUBLE:
+                GET_BYTES(&d, sizeof(d));
+                append_arg(out, sp, spec.stars, sv, (long double)d);
+                break;
+            case ARG::STR: {
+                GET_BYTES(&n, sizeof(n));
+                if (end - p < (ptrdiff_t)n) {
+                    out.append("?");
+                    return false;
+                }
+                std::string s(p, n);
+                p += n;
+                append_arg(out, sp, spec.stars, sv, s.c_str());
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+#undef GET_BYTES
+    return true;
+}
+
+}  // namespace kim
@@ -0,0 +1,54 @@
+#ifndef __KIM_LOG_BIN_H__
+#define __KIM_LOG_BIN_H__
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+namespace kim {
+
+/* binary log: a call site (file, func, line, fmt) is written once per
+ * process as a SITE record, then every line is a MSG record which carries
+ * the site id and the raw printf arguments, no formatting in server.
+ * tool kimlog (src/test/kimlog) decodes the file to text format.
+ *
+ * record: [log_bin_head_t][payload], host byte order.
+ * SITE payload: [uint32 line][file\0][func\0][fmt\0]
+ * MSG payload:  arguments in fmt's order, numbers are 8 bytes,
+ *               strings are [uint32 len][bytes].
+ * TEXT payload: plain message, for logger's own notices. */
+
+#define LOG_BIN_MAGIC 0x4b4c /* "KL" */
+
+enum {
+    LOG_BIN_SITE = 1,
+    LOG_BIN_MSG = 2,
+    LOG_BIN_TEXT = 3,
+};
+
+typedef struct log_bin_head_s {
+    uint16_t magic;
+    uint8_t type;
+    uint8_t level;
+    uint32_t len; /* record's len, head included. */
+    int32_t pid;
+    int16_t worker_index;
+    uint8_t is_manager;
+    uint8_t reserved;
+    uint32_t site_id; /* site id of process. */
+    uint32_t reserved2;
+    int64_t time_ms; /* wall clock time. */
+} log_bin_head_t;
+
+/* encode printf's arguments by fmt, return encoded len,
+ * string which is too long for the buffer is truncated. */
+int log_bin_encode_args(char* buf, size_t size, const char* fmt, va_list ap);
+
+/* format the encoded arguments by fmt, like vsnprintf. */
+bool log_bin_decode_args(const char* fmt, const char* data, size_t len, std::string& out);
+
+}  // namespace kim
+
+#endif  //__KIM_LOG_BIN_H__
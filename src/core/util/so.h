@@ -1,6 +1,8 @@
 #ifndef __KIM_SO_H__
 #define __KIM_SO_H__
 
+#include <time.h>
+
 #include <iostream>
 
 namespace kim {
@@ -15,10 +17,13 @@ class So {
     void set_so_path(const std::string& path) { m_so_path = path; }
     const std::string& so_path() const { return m_so_path; }
     const char* so_path() { return m_so_path.c_str(); }
+    void set_so_mtime(time_t mtime) { m_so_mtime = mtime; }
+    time_t so_mtime() const { return m_so_mtime; }
 
    protected:
     std::string m_so_path;        // module so path.
     void* m_so_handle = nullptr;  // for dlopen ptr.
+    time_t m_so_mtime = 0;        // so file's modified time when it is loaded.
 };
 
 }  // namespace kim
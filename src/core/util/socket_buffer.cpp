@@ -4,6 +4,55 @@
 
 namespace kim {
 
+SegmentPool::~SegmentPool() {
+    buffer_segment_t* seg;
+    while (m_free != nullptr) {
+        seg = m_free;
+        m_free = seg->next;
+        free(seg);
+    }
+    m_free_cnt = 0;
+}
+
+buffer_segment_t* SegmentPool::alloc(size_t min) {
+    buffer_segment_t* seg = nullptr;
+
+    m_alloc_cnt++;
+    if (min <= SEGMENT_SIZE && m_free != nullptr) {
+        seg = m_free;
+        m_free = seg->next;
+        m_free_cnt--;
+        m_reuse_cnt++;
+    } else {
+        size_t cap = (min > SEGMENT_SIZE) ? min : SEGMENT_SIZE;
+        seg = (buffer_segment_t*)malloc(sizeof(buffer_segment_t) + cap);
+        if (seg == nullptr) {
+            return nullptr;
+        }
+        seg->data = (char*)seg + sizeof(buffer_segment_t);
+        seg->cap = cap;
+    }
+
+    seg->next = nullptr;
+    seg->r = seg->w = 0;
+    return seg;
+}
+
+void SegmentPool::release(buffer_segment_t* seg) {
+    if (seg == nullptr) {
+        return;
+    }
+
+    if (seg->cap != SEGMENT_SIZE || m_free_cnt >= m_max_free_cnt) {
+        free(seg);
+        return;
+    }
+
+    seg->next = m_free;
+    m_free = seg;
+    m_free_cnt++;
+}
+
 int SocketBuffer::_vprintf(const char* fmt, va_list ap) {
     char* buffer;
     size_t space;
@@ -16,7 +65,7 @@ int SocketBuffer::_vprintf(const char* fmt, va_list ap) {
     }
 
     for (;;) {
-        buffer = m_buffer + m_write_idx;
+        buffer = raw_write_buffer();
         space = writeable_len();
 
 #ifndef va_copy
@@ -61,6 +110,11 @@ int SocketBuffer::write_fd(int fd, int& err) {
         return 0;
     }
 
+    if (is_chain()) {
+        SocketBuffer* sbuf = this;
+        return write_fd(fd, &sbuf, 1, err);
+    }
+
 #if !defined(__APPLE__) && defined(HAVE_MSG_NOSIGNAL)
     n = ::send(fd, m_buffer + m_read_idx, readable, MSG_NOSIGNAL);
 #else
@@ -75,7 +129,54 @@ int SocketBuffer::write_fd(int fd, int& err) {
     return n;
 }
 
+int SocketBuffer::write_fd(int fd, SocketBuffer** bufs, int cnt, int& err) {
+    int i, iov_cnt = 0;
+    struct msghdr msg;
+    struct iovec vec[IOV_MAX_CNT];
+
+    for (i = 0; i < cnt && iov_cnt < IOV_MAX_CNT; i++) {
+        if (bufs[i] != nullptr) {
+            iov_cnt += bufs[i]->fill_iovec(vec + iov_cnt, IOV_MAX_CNT - iov_cnt);
+        }
+    }
+
+    if (iov_cnt == 0) {
+        return 0;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = vec;
+    msg.msg_iovlen = iov_cnt;
+
+#if !defined(__APPLE__) && defined(HAVE_MSG_NOSIGNAL)
+    int n = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+#else
+    int n = ::sendmsg(fd, &msg, 0);
+#endif
+
+    if (n < 0) {
+        err = errno;
+        return n;
+    }
+
+    /* partial write, consume the buffers in order. */
+    size_t len, left = n;
+    for (i = 0; i < cnt && left > 0; i++) {
+        if (bufs[i] != nullptr) {
+            len = bufs[i]->readable_len();
+            len = (len < left) ? len : left;
+            bufs[i]->skip_bytes(len);
+            left -= len;
+        }
+    }
+    return n;
+}
+
 int SocketBuffer::read_fd(int fd, int& err) {
+    if (is_chain()) {
+        return chain_read_fd(fd, err);
+    }
+
     char extrabuf[32768];
     struct iovec vec[2];
     size_t writable = writeable_len();
@@ -97,4 +198,317 @@ int SocketBuffer::read_fd(int fd, int& err) {
     return n;
 }
 
+int SocketBuffer::fill_iovec(struct iovec* iov, int iov_cnt) {
+    int cnt = 0;
+    if (iov == nullptr || iov_cnt <= 0 || !is_readable()) {
+        return 0;
+    }
+
+    if (!is_chain()) {
+        iov[0].iov_base = m_buffer + m_read_idx;
+        iov[0].iov_len = readable_len();
+        return 1;
+    }
+
+    for (buffer_segment_t* seg = m_head; seg != nullptr && cnt < iov_cnt; seg = seg->next) {
+        if (seg->w > seg->r) {
+            iov[cnt].iov_base = seg->data + seg->r;
+            iov[cnt].iov_len = seg->w - seg->r;
+            cnt++;
+        }
+    }
+    return cnt;
+}
+
+const char* SocketBuffer::make_contiguous(size_t len) {
+    if (len == 0 || len > readable_len()) {
+        return nullptr;
+    }
+
+    if (contiguous_len() >= len) {
+        return raw_read_buffer();
+    }
+
+    /* first segment is large enough, pull the following bytes into it. */
+    if (m_head->cap >= len) {
+        size_t n, data_len = m_head->w - m_head->r;
+        if (m_head->cap - m_head->r < len) {
+            memmove(m_head->data, m_head->data + m_head->r, data_len);
+            m_head->r = 0;
+            m_head->w = data_len;
+        }
+
+        buffer_segment_t* seg;
+        while (m_head->w - m_head->r < len) {
+            seg = m_head->next;
+            n = len - (m_head->w - m_head->r);
+            n = (n < seg->w - seg->r) ? n : seg->w - seg->r;
+            memcpy(m_head->data + m_head->w, seg->data + seg->r, n);
+            m_head->w += n;
+            seg->r += n;
+            if (seg->r == seg->w && seg != m_tail) {
+                m_head->next = seg->next;
+                m_pool->release(seg);
+            }
+        }
+        return raw_read_buffer();
+    }
+
+    /* copy the bytes into a new segment, and link it in front. */
+    buffer_segment_t* seg = m_pool->alloc(len);
+    if (seg == nullptr) {
+        return nullptr;
+    }
+    chain_copy_out(seg->data, len);
+    seg->w = len;
+    chain_drop(len);
+    seg->next = m_head;
+    m_head = seg;
+    if (m_tail == nullptr) {
+        m_tail = seg;
+    }
+    return raw_read_buffer();
+}
+
+bool SocketBuffer::chain_reserve(size_t min) {
+    buffer_segment_t* seg;
+
+    if (m_tail != nullptr && m_tail->r == m_tail->w) {
+        /* tail has no data, reuse it or replace it. */
+        m_tail->r = m_tail->w = 0;
+        if (m_tail->cap >= min) {
+            return true;
+        }
+
+        seg = m_pool->alloc(min);
+        if (seg == nullptr) {
+            return false;
+        }
+
+        if (m_head == m_tail) {
+            m_head = seg;
+        } else {
+            buffer_segment_t* prev = m_head;
+            while (prev->next != m_tail) {
+                prev = prev->next;
+            }
+            prev->next = seg;
+        }
+        m_pool->release(m_tail);
+        m_tail = seg;
+        return true;
+    }
+
+    seg = m_pool->alloc(min);
+    if (seg == nullptr) {
+        return false;
+    }
+
+    if (m_tail == nullptr) {
+        m_head = m_tail = seg;
+    } else {
+        m_tail->next = seg;
+        m_tail = seg;
+    }
+    return true;
+}
+
+int SocketBuffer::chain_append(const void* data_in, size_t len) {
+    size_t n, left = len;
+    const char* p = (const char*)data_in;
+
+    while (left > 0) {
+        if (writeable_len() == 0 && !chain_reserve(1)) {
+            chain_truncate(len - left);
+            return -1;
+        }
+        n = writeable_len();
+        n = (n < left) ? n : left;
+        memcpy(m_tail->data + m_tail->w, p, n);
+        m_tail->w += n;
+        m_write_idx += n;
+        p += n;
+        left -= n;
+    }
+    return len;
+}
+
+int SocketBuffer::chain_copy_out(void* data_out, size_t len) {
+    size_t n, left = len;
+    char* p = (char*)data_out;
+
+    for (buffer_segment_t* seg = m_head; seg != nullptr && left > 0; seg = seg->next) {
+        n = seg->w - seg->r;
+        n = (n < left) ? n : left;
+        memcpy(p, seg->data + seg->r, n);
+        p += n;
+        left -= n;
+    }
+    return len - left;
+}
+
+int SocketBuffer::chain_set_bytes(const void* data, size_t len, size_t index) {
+    if (index < m_read_idx) {
+        return -1;
+    }
+
+    size_t n, offset = index - m_read_idx, left = len;
+    const char* p = (const char*)data;
+
+    for (buffer_segment_t* seg = m_head; seg != nullptr && left > 0; seg = seg->next) {
+        n = seg->w - seg->r;
+        if (offset >= n) {
+            offset -= n;
+            continue;
+        }
+        n -= offset;
+        n = (n < left) ? n : left;
+        memcpy(seg->data + seg->r + offset, p, n);
+        offset = 0;
+        p += n;
+        left -= n;
+    }
+    return len - left;
+}
+
+void SocketBuffer::chain_drop(size_t len) {
+    size_t n;
+    buffer_segment_t* seg;
+
+    while (m_head != nullptr && (len > 0 || m_head->r == m_head->w)) {
+        n = m_head->w - m_head->r;
+        n = (n < len) ? n : len;
+        m_head->r += n;
+        len -= n;
+        if (m_head->r < m_head->w) {
+            break;
+        }
+
+        /* recycle the consumed segment. */
+        seg = m_head;
+        m_head = seg->next;
+        if (m_head == nullptr) {
+            m_tail = nullptr;
+        }
+        m_pool->release(seg);
+    }
+}
+
+void SocketBuffer::chain_consume(size_t len) {
+    if (len > readable_len()) {
+        len = readable_len();
+    }
+    chain_drop(len);
+    m_read_idx += len;
+    if (!is_readable()) {
+        chain_release();
+        m_read_idx = m_write_idx = 0;
+    }
+}
+
+void SocketBuffer::chain_truncate(size_t len) {
+    if (len >= readable_len()) {
+        chain_release();
+        m_read_idx = m_write_idx = 0;
+        return;
+    }
+
+    size_t n, keep = readable_len() - len;
+    buffer_segment_t* seg = m_head;
+    for (;;) {
+        n = seg->w - seg->r;
+        if (n >= keep) {
+            break;
+        }
+        keep -= n;
+        seg = seg->next;
+    }
+
+    seg->w = seg->r + keep;
+    m_write_idx -= len;
+
+    /* release the segments behind. */
+    buffer_segment_t* next = seg->next;
+    seg->next = nullptr;
+    m_tail = seg;
+    while (next != nullptr) {
+        seg = next;
+        next = seg->next;
+        m_pool->release(seg);
+    }
+}
+
+void SocketBuffer::chain_release() {
+    buffer_segment_t* seg;
+    while (m_head != nullptr) {
+        seg = m_head;
+        m_head = seg->next;
+        m_pool->release(seg);
+    }
+    m_tail = nullptr;
+}
+
+size_t SocketBuffer::chain_capacity() const {
+    size_t cap = 0;
+    for (buffer_segment_t* seg = m_head; seg != nullptr; seg = seg->next) {
+        cap += seg->cap;
+    }
+    return cap;
+}
+
+int SocketBuffer::chain_read_fd(int fd, int& err) {
+    int i, cnt = 0;
+    struct iovec vec[MAX_READ_SEGMENTS + 1];
+    buffer_segment_t* segs[MAX_READ_SEGMENTS] = {nullptr};
+    size_t n, writable = writeable_len();
+
+    if (writable > 0) {
+        vec[cnt].iov_base = raw_write_buffer();
+        vec[cnt].iov_len = writable;
+        cnt++;
+    }
+
+    for (i = 0; i < MAX_READ_SEGMENTS; i++) {
+        segs[i] = m_pool->alloc();
+        if (segs[i] == nullptr) {
+            break;
+        }
+        vec[cnt].iov_base = segs[i]->data;
+        vec[cnt].iov_len = segs[i]->cap;
+        cnt++;
+    }
+
+    int ret = readv(fd, vec, cnt);
+    if (ret < 0) {
+        err = errno;
+        ret = -1;
+    }
+
+    /* fill the tail first, then link the used segments. */
+    size_t left = (ret > 0) ? ret : 0;
+    if (writable > 0) {
+        n = (left < writable) ? left : writable;
+        advance_write_index(n);
+        left -= n;
+    }
+
+    for (i = 0; i < MAX_READ_SEGMENTS && segs[i] != nullptr; i++) {
+        if (left == 0) {
+            m_pool->release(segs[i]);
+            continue;
+        }
+        n = (left < segs[i]->cap) ? left : segs[i]->cap;
+        segs[i]->w = n;
+        if (m_tail == nullptr) {
+            m_head = m_tail = segs[i];
+        } else {
+            m_tail->next = segs[i];
+            m_tail = segs[i];
+        }
+        m_write_idx += n;
+        left -= n;
+    }
+    return ret;
+}
+
 }  // namespace kim
@@ -21,12 +21,60 @@
  *       |                   |                  |                  |
  *   m_buffer    <=      m_read_idx   <=   m_write_idx    <=   m_buffer_len
  *
+ * chain mode (created with a SegmentPool):
+ *
+ *   m_head                                            m_tail
+ *       +------------+     +------------+     +------------+
+ *       |  segment   | --> |  segment   | --> |  segment   | --> nullptr
+ *       +------------+     +------------+     +------------+
+ *
+ *   data is appended to the tail segment, a new segment is linked when it
+ *   is full, so written bytes are never moved. consumed segments go back to
+ *   the pool. m_read_idx / m_write_idx are logical byte counters.
  */
 
 namespace kim {
 
 typedef unsigned int uint32_t;
 
+/* fixed-size slab for chain mode. */
+typedef struct buffer_segment_s {
+    struct buffer_segment_s* next;
+    char* data;  /* data area behind the segment head. */
+    size_t cap;  /* data area length. */
+    size_t r;    /* read position. */
+    size_t w;    /* write position. */
+} buffer_segment_t;
+
+/* segments free list, shared by all connections of a process. */
+class SegmentPool {
+   public:
+    static const size_t SEGMENT_SIZE = 4096;
+    static const size_t DEFAULT_MAX_FREE_CNT = 1024;
+
+    SegmentPool(size_t max_free_cnt = DEFAULT_MAX_FREE_CNT) : m_max_free_cnt(max_free_cnt) {}
+    virtual ~SegmentPool();
+
+    SegmentPool(const SegmentPool&) = delete;
+    SegmentPool& operator=(const SegmentPool&) = delete;
+
+    /* segment capacity >= min. oversize segment is not pooled. */
+    buffer_segment_t* alloc(size_t min = SEGMENT_SIZE);
+    void release(buffer_segment_t* seg);
+
+    /* statistics. */
+    size_t free_cnt() { return m_free_cnt; }
+    size_t alloc_cnt() { return m_alloc_cnt; }
+    size_t reuse_cnt() { return m_reuse_cnt; }
+
+   private:
+    buffer_segment_t* m_free = nullptr; /* free list. */
+    size_t m_free_cnt = 0;
+    size_t m_max_free_cnt = DEFAULT_MAX_FREE_CNT;
+    size_t m_alloc_cnt = 0; /* alloc times. */
+    size_t m_reuse_cnt = 0; /* alloc times which hit the free list. */
+};
+
 class SocketBuffer {
    private:
     char* m_buffer = nullptr;  // total allocation available in the buffer field.
@@ -34,31 +82,74 @@ class SocketBuffer {
     size_t m_write_idx = 0;    // current write index.
     size_t m_read_idx = 0;     // current read index.
 
+    SegmentPool* m_pool = nullptr;        // chain mode, segments come from pool.
+    buffer_segment_t* m_head = nullptr;  // chain mode, first readable segment.
+    buffer_segment_t* m_tail = nullptr;  // chain mode, segment for appending.
+
    public:
     static const size_t BUFFER_MAX_READ = 8192;
     static const size_t DEFAULT_BUFFER_SIZE = 32;
+    static const int MAX_READ_SEGMENTS = 4;
+    static const int IOV_MAX_CNT = 64;
 
     inline SocketBuffer() {}
     inline SocketBuffer(size_t size) { ensure_writeable(size); }
+    inline SocketBuffer(SegmentPool* pool) : m_pool(pool) {}
     inline ~SocketBuffer() {
         if (m_buffer != nullptr) {
             free(m_buffer);
             m_buffer = nullptr;
         }
+        chain_release();
     }
+    inline bool is_chain() const { return m_pool != nullptr; }
     inline size_t read_index() { return m_read_idx; }
     inline size_t write_index() { return m_write_idx; }
-    inline void set_read_index(size_t idx) { m_read_idx = idx; }
-    inline void advance_read_index(int step) { m_read_idx += step; }
-    inline void set_write_index(size_t idx) { m_write_idx = idx; }
-    inline void advance_write_index(int step) { m_write_idx += step; }
+    inline void set_read_index(size_t idx) {
+        if (is_chain()) {
+            if (idx > m_read_idx) chain_consume(idx - m_read_idx);
+            return;
+        }
+        m_read_idx = idx;
+    }
+    inline void advance_read_index(int step) {
+        if (is_chain()) {
+            chain_consume(step);
+            return;
+        }
+        m_read_idx += step;
+    }
+    inline void set_write_index(size_t idx) {
+        if (is_chain()) {
+            (idx < m_write_idx) ? chain_truncate(m_write_idx - idx)
+                                : advance_write_index(idx - m_write_idx);
+            return;
+        }
+        m_write_idx = idx;
+    }
+    inline void advance_write_index(int step) {
+        if (is_chain() && m_tail != nullptr) {
+            m_tail->w += step;
+        }
+        m_write_idx += step;
+    }
     inline bool is_readable() { return m_write_idx > m_read_idx; }
-    inline bool is_writeable() { return m_buffer_len > m_write_idx; }
+    inline bool is_writeable() { return writeable_len() > 0; }
     inline size_t readable_len() { return is_readable() ? m_write_idx - m_read_idx : 0; }
-    inline size_t writeable_len() { return is_writeable() ? m_buffer_len - m_write_idx : 0; }
+    inline size_t writeable_len() {
+        if (is_chain()) {
+            return (m_tail != nullptr) ? m_tail->cap - m_tail->w : 0;
+        }
+        return (m_buffer_len > m_write_idx) ? m_buffer_len - m_write_idx : 0;
+    }
 
     // recovery writebale buffer and alreay readed buffer.
     inline size_t compact(size_t size) {
+        if (is_chain()) {
+            // consumed segments have been recycled, nothing to do.
+            return 0;
+        }
+
         if (writeable_len() < size) {
             return 0;
         }
@@ -93,6 +184,11 @@ class SocketBuffer {
             return true;
         }
 
+        if (is_chain()) {
+            // link a new segment, the written bytes stay where they are.
+            return chain_reserve(min);
+        }
+
         // not enough space to write, then alloc more.
         size_t cap = capacity();
         if (cap > BUFFER_MAX_READ) {
@@ -122,22 +218,49 @@ class SocketBuffer {
         return false;
     }
 
-    inline char* raw_write_buffer() { return m_buffer + m_write_idx; }
-    inline const char* raw_write_buffer() const { return m_buffer + m_read_idx; }
-    inline const char* raw_read_buffer() const { return m_buffer + m_read_idx; }
-    inline size_t capacity() const { return m_buffer_len; }
-    inline void limit() { m_buffer_len = m_write_idx; }
-    inline void clear() { m_write_idx = m_read_idx = 0; }
+    inline char* raw_write_buffer() {
+        if (is_chain()) {
+            return (m_tail != nullptr) ? m_tail->data + m_tail->w : nullptr;
+        }
+        return m_buffer + m_write_idx;
+    }
+    inline const char* raw_write_buffer() const { return raw_read_buffer(); }
+    /* chain mode: only the bytes of the first segment are contiguous,
+     * use make_contiguous() to read a larger block. */
+    inline const char* raw_read_buffer() const {
+        if (is_chain()) {
+            return (m_head != nullptr) ? m_head->data + m_head->r : nullptr;
+        }
+        return m_buffer + m_read_idx;
+    }
+    inline size_t capacity() const { return is_chain() ? chain_capacity() : m_buffer_len; }
+    inline void limit() {
+        if (!is_chain()) {
+            m_buffer_len = m_write_idx;
+        }
+    }
+    inline void clear() {
+        chain_release();
+        m_write_idx = m_read_idx = 0;
+    }
     inline int _read(void* data_out, size_t len) {
         if (len > readable_len()) {
             return -1;
         }
+        if (is_chain()) {
+            chain_copy_out(data_out, len);
+            chain_consume(len);
+            return len;
+        }
         memcpy(data_out, m_buffer + m_read_idx, len);
         m_read_idx += len;
         return len;
     }
 
     inline int _write(const void* data_in, size_t len) {
+        if (is_chain()) {
+            return chain_append(data_in, len);
+        }
         if (!ensure_writeable(len)) {
             return -1;
         }
@@ -153,11 +276,20 @@ class SocketBuffer {
         if (len > unit->readable_len()) {
             len = unit->readable_len();
         }
-        int ret = _write(unit->m_buffer + unit->m_read_idx, len);
-        if (ret > 0) {
-            unit->m_read_idx += ret;
+
+        int ret, total = 0;
+        while (len > 0) {
+            /* copy block by block, the unit maybe a chain buffer. */
+            size_t block = unit->contiguous_len();
+            ret = _write(unit->raw_read_buffer(), (block < len) ? block : len);
+            if (ret <= 0) {
+                return (total > 0) ? total : ret;
+            }
+            unit->skip_bytes(ret);
+            total += ret;
+            len -= ret;
         }
-        return ret;
+        return total;
     }
 
     inline int write_byte(char ch) { return _write(&ch, 1); }
@@ -176,6 +308,9 @@ class SocketBuffer {
         if (index + len > m_write_idx) {
             return -1;
         }
+        if (is_chain()) {
+            return chain_set_bytes(data, len, index);
+        }
         memcpy(m_buffer + index, data, len);
         return len;
     }
@@ -189,6 +324,9 @@ class SocketBuffer {
         if (len > readable_len()) {
             len = readable_len();
         }
+        if (is_chain()) {
+            return chain_copy_out(data_out, len);
+        }
         memcpy(data_out, m_buffer + m_read_idx, len);
         return len;
     }
@@ -197,9 +335,9 @@ class SocketBuffer {
         if (unit == nullptr || !unit->ensure_writeable(len)) {
             return -1;
         }
-        int ret = copy_out(unit->m_buffer + +unit->m_write_idx, len);
+        int ret = copy_out(unit->raw_write_buffer(), len);
         if (ret > 0) {
-            unit->m_write_idx += ret;
+            unit->advance_write_index(ret);
         }
         return ret;
     }
@@ -207,6 +345,9 @@ class SocketBuffer {
     inline void skip_bytes(size_t len) { advance_read_index(len); }
 
     inline void DiscardReadedBytes() {
+        if (is_chain()) {
+            return;
+        }
         if (m_read_idx > 0) {
             if (is_readable()) {
                 size_t tmp = readable_len();
@@ -219,12 +360,48 @@ class SocketBuffer {
         }
     }
 
+    /* readable bytes which can be read from raw_read_buffer() directly. */
+    inline size_t contiguous_len() {
+        if (is_chain()) {
+            return (m_head != nullptr) ? m_head->w - m_head->r : 0;
+        }
+        return readable_len();
+    }
+
+    /* make the first len readable bytes contiguous, and return them. */
+    const char* make_contiguous(size_t len);
+
     int _printf(const char* fmt, ...);
     int _vprintf(const char* fmt, va_list ap);
     int read_fd(int fd, int& err);
     int write_fd(int fd, int& err);
+    /* gather the buffers' readable data into one sendmsg. */
+    static int write_fd(int fd, SocketBuffer** bufs, int cnt, int& err);
+
+    /* fill readable blocks into iov, return the count of used iov. */
+    int fill_iovec(struct iovec* iov, int iov_cnt);
+
+    inline std::string ToString() {
+        if (is_chain()) {
+            std::string data(readable_len(), '\0');
+            chain_copy_out(&data[0], data.size());
+            return data;
+        }
+        return std::string(m_buffer + m_read_idx, readable_len());
+    }
 
-    inline std::string ToString() { return std::string(m_buffer + m_read_idx, readable_len()); }
+   private:
+    /* chain mode. */
+    bool chain_reserve(size_t min);
+    int chain_append(const void* data_in, size_t len);
+    int chain_copy_out(void* data_out, size_t len);
+    int chain_set_bytes(const void* data, size_t len, size_t index);
+    void chain_drop(size_t len);
+    void chain_consume(size_t len);
+    void chain_truncate(size_t len);
+    void chain_release();
+    size_t chain_capacity() const;
+    int chain_read_fd(int fd, int& err);
 };
 
 }  // namespace kim
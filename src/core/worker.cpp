@@ -23,6 +23,8 @@ bool Worker::init(const worker_info_t* info, const CJsonObject& conf) {
     m_worker_info.data_fd = info->data_fd;
     m_worker_info.index = info->index;
     m_worker_info.pid = getpid();
+    m_worker_info.send_ring = info->send_ring;
+    m_worker_info.recv_ring = info->recv_ring;
 
     m_conf = conf;
 
@@ -83,6 +85,26 @@ bool Worker::load_logger() {
 
     m_logger->set_process_type(false);
     m_logger->set_worker_index(m_worker_info.index);
+
+    if (!m_logger->set_format(m_conf("log_format").c_str())) {
+        LOG_ERROR("invalid log_format: %s", m_conf("log_format").c_str());
+        return false;
+    }
+
+    bool is_async = false;
+    m_conf.Get("log_async", is_async);
+    if (is_async) {
+        int ring_cnt = Log::ASYNC_RING_CNT;
+        m_conf.Get("log_async_ring_cnt", ring_cnt);
+        if (!m_logger->set_full_policy(m_conf("log_full_policy").c_str())) {
+            LOG_ERROR("invalid log_full_policy: %s", m_conf("log_full_policy").c_str());
+            return false;
+        }
+        if (!m_logger->set_async((size_t)ring_cnt)) {
+            LOG_ERROR("set async log failed! ring cnt: %d", ring_cnt);
+            return false;
+        }
+    }
     return true;
 }
 
@@ -102,6 +124,14 @@ bool Worker::load_network() {
         return false;
     }
 
+    if (m_worker_info.send_ring != nullptr &&
+        !m_net->add_shm_chanel(m_worker_info.ctrl_fd, m_worker_info.send_ring,
+                               m_worker_info.recv_ring)) {
+        LOG_WARN("add shm chanel failed, ctrl chanel uses socket!");
+        SAFE_DELETE(m_worker_info.send_ring);
+        SAFE_DELETE(m_worker_info.recv_ring);
+    }
+
     LOG_INFO("load net work done!");
     return true;
 }
@@ -1,9 +1,15 @@
 #include "worker_data_mgr.h"
 
+#include <algorithm>
+
 #include "server.h"
+#include "util/hash.h"
 
 namespace kim {
 
+#define WORKER_RING_TYPE "worker"
+#define WORKER_RING_HOST "127.0.0.1"
+
 WorkerDataMgr::WorkerDataMgr(Log* logger) : Logger(logger) {
     m_itr_worker = m_workers.begin();
 }
@@ -15,6 +21,8 @@ WorkerDataMgr::~WorkerDataMgr() {
     m_workers.clear();
     m_itr_worker = m_workers.end();
     m_index_workers.clear();
+    m_worker_list.clear();
+    SAFE_DELETE(m_ring);
 }
 
 bool WorkerDataMgr::add_worker_info(int index, int pid, int ctrl_fd, int data_fd) {
@@ -34,6 +42,11 @@ bool WorkerDataMgr::add_worker_info(int index, int pid, int ctrl_fd, int data_fd
         m_workers[pid] = info;
         m_itr_worker = m_workers.begin();
         m_index_workers[index] = info;
+        m_worker_list.push_back(info);
+        if (index > m_max_worker_index) {
+            add_ring_nodes(index);
+            m_max_worker_index = index;
+        }
         return true;
     }
     return false;
@@ -63,6 +76,9 @@ bool WorkerDataMgr::del_worker_info(int pid) {
     m_index_workers.erase(info->index);
     m_workers.erase(it);
     m_itr_worker = m_workers.begin();
+    m_worker_list.erase(
+        std::remove(m_worker_list.begin(), m_worker_list.end(), info),
+        m_worker_list.end());
     SAFE_DELETE(info);
     return true;
 }
@@ -83,15 +99,159 @@ bool WorkerDataMgr::get_worker_chanel(int pid, int* chs) {
     return true;
 }
 
-int WorkerDataMgr::get_next_worker_data_fd() {
+bool WorkerDataMgr::update_payload(const Payload& pl) {
+    worker_info_t* info = get_worker_info(pl.worker_index());
+    if (info == nullptr) {
+        return false;
+    }
+    info->payload = pl;
+    info->pending_cnt = 0;
+    return true;
+}
+
+bool WorkerDataMgr::set_dispatch(const std::string& policy) {
+    for (int i = 0; i < static_cast<int>(DISPATCH::COUNT); i++) {
+        if (policy == dispatch_name(static_cast<DISPATCH>(i))) {
+            m_dispatch = static_cast<DISPATCH>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* WorkerDataMgr::dispatch_name(DISPATCH type) {
+    switch (type) {
+        case DISPATCH::ROUND_ROBIN:
+            return "round_robin";
+        case DISPATCH::LEAST_CONN:
+            return "least_conn";
+        case DISPATCH::P2C:
+            return "p2c";
+        case DISPATCH::IP_HASH:
+            return "ip_hash";
+        case DISPATCH::SESSION:
+            return "session";
+        default:
+            return "unknown";
+    }
+}
+
+int WorkerDataMgr::get_next_worker_data_fd(const char* ip, const char* sessid) {
     if (m_workers.empty()) {
         return -1;
     }
+
+    worker_info_t* info = nullptr;
+    DISPATCH type = m_dispatch;
+
+    switch (type) {
+        case DISPATCH::LEAST_CONN:
+            info = least_conn();
+            break;
+        case DISPATCH::P2C:
+            info = power_of_two_choices();
+            break;
+        case DISPATCH::IP_HASH:
+            info = ip_hash(ip);
+            if (info == nullptr) {
+                /* no ip (resend) or the worker is restarting. */
+                type = DISPATCH::LEAST_CONN;
+                info = least_conn();
+            }
+            break;
+        case DISPATCH::SESSION:
+            info = session_hash(sessid);
+            if (info == nullptr) {
+                /* no session id or the owner is restarting. */
+                type = DISPATCH::LEAST_CONN;
+                info = least_conn();
+            }
+            break;
+        default:
+            info = next_round_robin();
+            break;
+    }
+
+    if (info == nullptr) {
+        return -1;
+    }
+
+    /* payload is reported every second, count the fds between reports. */
+    info->dispatch_cnt++;
+    info->pending_cnt++;
+    m_dispatch_cnts[static_cast<int>(type)]++;
+    return info->data_fd;
+}
+
+uint32_t WorkerDataMgr::worker_load(const worker_info_t* info) const {
+    return info->payload.conn_cnt() + info->pending_cnt;
+}
+
+worker_info_t* WorkerDataMgr::next_round_robin() {
     m_itr_worker++;
     if (m_itr_worker == m_workers.end()) {
         m_itr_worker = m_workers.begin();
     }
-    return m_itr_worker->second->data_fd;
+    return m_itr_worker->second;
+}
+
+worker_info_t* WorkerDataMgr::least_conn() {
+    worker_info_t* info = nullptr;
+    for (auto& v : m_worker_list) {
+        if (info == nullptr || worker_load(v) < worker_load(info) ||
+            (worker_load(v) == worker_load(info) &&
+             v->payload.cmd_cnt() < info->payload.cmd_cnt())) {
+            info = v;
+        }
+    }
+    return info;
+}
+
+worker_info_t* WorkerDataMgr::power_of_two_choices() {
+    size_t cnt = m_worker_list.size();
+    if (cnt == 1) {
+        return m_worker_list[0];
+    }
+
+    /* two different workers, the less loaded wins. */
+    size_t a = rand() % cnt;
+    size_t b = (a + 1 + rand() % (cnt - 1)) % cnt;
+    worker_info_t* x = m_worker_list[a];
+    worker_info_t* y = m_worker_list[b];
+    if (worker_load(x) != worker_load(y)) {
+        return (worker_load(x) < worker_load(y)) ? x : y;
+    }
+    return (x->payload.cmd_cnt() <= y->payload.cmd_cnt()) ? x : y;
+}
+
+worker_info_t* WorkerDataMgr::ip_hash(const char* ip) {
+    if (ip == nullptr || *ip == '\0' || m_max_worker_index <= 0) {
+        return nullptr;
+    }
+
+    /* hash on worker index, not live workers, so the client keeps its
+     * worker while the others restart. */
+    int index = hash_fnv1a_64(ip, strlen(ip)) % m_max_worker_index + 1;
+    return get_worker_info(index);
+}
+
+void WorkerDataMgr::add_ring_nodes(int max_index) {
+    if (m_ring == nullptr) {
+        m_ring = new Nodes(m_logger);
+    }
+    /* the ring never shrinks, a restarting worker keeps its sessions. */
+    for (int i = m_max_worker_index + 1; i <= max_index; i++) {
+        m_ring->add_node(WORKER_RING_TYPE, WORKER_RING_HOST, 0, i);
+    }
+}
+
+worker_info_t* WorkerDataMgr::session_hash(const char* sessid) {
+    if (sessid == nullptr || *sessid == '\0' || m_ring == nullptr) {
+        return nullptr;
+    }
+
+    node_t* node = m_ring->get_node_in_hash(WORKER_RING_TYPE, sessid);
+    return (node != nullptr) ? get_worker_info(node->worker_index) : nullptr;
 }
 
 }  // namespace kim
\ No newline at end of file
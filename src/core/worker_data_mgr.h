@@ -1,6 +1,7 @@
 #ifndef __KIM_WORKER_DATA_MGR_H__
 #define __KIM_WORKER_DATA_MGR_H__
 
+#include "net/shm_ring.h"
 #include "nodes.h"
 #include "protobuf/sys/payload.pb.h"
 #include "util/log.h"
@@ -14,29 +15,68 @@ typedef struct worker_info_s {
     int data_fd;           /* socketpair for parent and child. */
     std::string work_path; /* process work path. */
     Payload payload;       /* payload info. */
+    uint32_t dispatch_cnt; /* fds dispatched to worker. */
+    uint32_t pending_cnt;  /* fds dispatched after the last payload report. */
+    ShmRing* send_ring;    /* ctrl chanel's shared memory ring to peer. */
+    ShmRing* recv_ring;    /* ctrl chanel's shared memory ring from peer. */
 } worker_info_t;
 
 class WorkerDataMgr : public Logger {
    public:
+    /* how manager chooses worker to transfer client's fd. */
+    enum class DISPATCH {
+        ROUND_ROBIN = 0,
+        LEAST_CONN,
+        P2C,     /* power of two choices. */
+        IP_HASH, /* client's ip. */
+        SESSION, /* client's session id, by ketama ring of worker indices. */
+        COUNT,
+    };
+
     WorkerDataMgr(Log* logger);
     virtual ~WorkerDataMgr();
 
    public:
     bool add_worker_info(int index, int pid, int ctrl_fd, int data_fd);
     bool del_worker_info(int pid);
-    int get_next_worker_data_fd();
+    bool update_payload(const Payload& pl);
+    int get_next_worker_data_fd(const char* ip = nullptr, const char* sessid = nullptr);
     bool get_worker_chanel(int pid, int* chs);
     int get_worker_index(int pid);
     int get_worker_data_fd(int worker_index);
     worker_info_t* get_worker_info(int index);
     const std::unordered_map<int, worker_info_t*>& get_infos() const { return m_workers; }
 
+    /* dispatch policy. */
+    bool set_dispatch(const std::string& policy);
+    DISPATCH dispatch() const { return m_dispatch; }
+    static const char* dispatch_name(DISPATCH type);
+    uint32_t dispatch_cnt(DISPATCH type) const { return m_dispatch_cnts[static_cast<int>(type)]; }
+
    private:
+    worker_info_t* next_round_robin();
+    worker_info_t* least_conn();
+    worker_info_t* power_of_two_choices();
+    worker_info_t* ip_hash(const char* ip);
+    worker_info_t* session_hash(const char* sessid);
+    void add_ring_nodes(int max_index);
+    uint32_t worker_load(const worker_info_t* info) const;
+
+   private:
+    DISPATCH m_dispatch = DISPATCH::ROUND_ROBIN;
+    /* fds dispatched by each policy, ip hash may fall back to least conn. */
+    uint32_t m_dispatch_cnts[static_cast<int>(DISPATCH::COUNT)] = {0};
+    int m_max_worker_index = 0;
+    /* ketama ring of worker indices for session affinity. */
+    Nodes* m_ring = nullptr;
+
     /* key: pid. */
     std::unordered_map<int, worker_info_t*> m_workers;
     std::unordered_map<int, worker_info_t*>::iterator m_itr_worker;
     /* key: worker_index. */
     std::unordered_map<int, worker_info_t*> m_index_workers;
+    /* random access for p2c. */
+    std::vector<worker_info_t*> m_worker_list;
 };
 
 }  // namespace kim
@@ -2,6 +2,7 @@
 
 #include "protobuf/sys/nodes.pb.h"
 #include "sys_cmd.h"
+#include "util/clock.h"
 #include "util/util.h"
 
 namespace kim {
@@ -316,7 +317,7 @@ utility::zoo_rc ZkClient::bio_register_node(zk_task_t* task) {
     json_data.Add("host", json_value("node_host"));
     json_data.Add("port", json_value("node_port"));
     json_data.Add("worker_cnt", str_to_int(m_config("worker_cnt")));
-    json_data.Add("active_time", time_now());
+    json_data.Add("active_time", Clock::wall_time());
 
     LOG_TRACE("node info: %s", json_data["node"].ToString().c_str());
     ret = m_zk->set_node(node_path.c_str(), json_data.ToString(), -1);
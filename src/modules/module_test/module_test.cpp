@@ -23,7 +23,7 @@ Cmd::STATUS MoudleTest::hello_world(const Request& req) {
     obj.Add("code", 0);
     obj.Add("msg", "ok");
     obj.Add("data", data);
-    return response_http(req.fd_data(), obj.ToString());
+    return response_http(req, obj.ToString());
 }
 
 Cmd::STATUS MoudleTest::test_proto(const Request& req) {
@@ -44,7 +44,7 @@ Cmd::STATUS MoudleTest::test_auto_send(const Request& req) {
 }
 
 Cmd::STATUS MoudleTest::test_cmd(const Request& req) {
-    HANDLE_CMD(CmdHello);
+    HANDLE_POOLED_CMD(CmdHello);
 }
 
 Cmd::STATUS MoudleTest::test_redis(const Request& req) {
@@ -14,6 +14,10 @@ class SessionTest : public Session {
     void set_value(const std::string& v) { m_value = v; }
     const std::string& value() { return m_value; }
 
+    virtual size_t mem_size() const override {
+        return sizeof(*this) + m_sessid.capacity() + m_value.capacity();
+    }
+
    private:
     std::string m_value;
 };
@@ -0,0 +1,142 @@
+// g++ -g -std='c++11' -I ../../core kimlog.cpp ../../core/util/log_bin.cpp -o kimlog && ./kimlog ../../../bin/kimserver.log
+
+/* decode binary log (log_format: "binary") to text format. */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "util/log_bin.h"
+
+typedef struct site_s {
+    int line;
+    std::string file;
+    std::string func;
+    std::string fmt;
+} site_t;
+
+static const char g_levels[][10] = {"EMRG", "ALRT", "CRIT", "ERRO", "WARN", "NOTI", "INFO", "DBUG", "TRAC"};
+
+/* process's sites, key: (pid, site id). */
+static std::map<std::pair<int, uint32_t>, site_t> g_sites;
+
+static std::string format_time(int64_t time_ms) {
+    struct tm tm;
+    char buf[64];
+    time_t t = (time_t)(time_ms / 1000);
+    localtime_r(&t, &tm);
+    size_t len = strftime(buf, sizeof(buf), "[%Y-%m-%d %H:%M:%S.", &tm);
+    snprintf(buf + len, sizeof(buf) - len, "%03d]", (int)(time_ms % 1000));
+    return buf;
+}
+
+static void print_line(const kim::log_bin_head_t* head, const site_t* site, const std::string& msg) {
+    const char* level = (head->level < sizeof(g_levels) / sizeof(g_levels[0])) ? g_levels[head->level] : "????";
+    printf("[%s][%s%d][%d]%s", level, head->is_manager ? "M" : "W",
+           head->worker_index, head->pid, format_time(head->time_ms).c_str());
+    if (site != nullptr) {
+        printf("[%s:%s:%d]", site->file.c_str(), site->func.c_str(), site->line);
+    }
+    printf(" %s\n", msg.c_str());
+}
+
+static void handle_record(const kim::log_bin_head_t* head, const char* data, size_t len) {
+    auto key = std::make_pair((int)head->pid, head->site_id);
+
+    if (head->type == kim::LOG_BIN_SITE) {
+        site_t site;
+        uint32_t line = 0;
+        if (len < sizeof(line)) {
+            return;
+        }
+        memcpy(&line, data, sizeof(line));
+        site.line = (int)line;
+
+        /* file\0func\0fmt\0 */
+        const char* p = data + sizeof(line);
+        const char* end = data + len;
+        std::string* strs[] = {&site.file, &site.func, &site.fmt};
+        for (auto s : strs) {
+            const char* z = (const char*)memchr(p, '\0', end - p);
+            if (z == nullptr) {
+                return;
+            }
+            s->assign(p, z - p);
+            p = z + 1;
+        }
+        g_sites[key] = site;
+    } else if (head->type == kim::LOG_BIN_MSG) {
+        auto it = g_sites.find(key);
+        if (it == g_sites.end()) {
+            print_line(head, nullptr, "<unknown site: " + std::to_string(head->site_id) + ">");
+            return;
+        }
+        std::string msg;
+        kim::log_bin_decode_args(it->second.fmt.c_str(), data, len, msg);
+        print_line(head, &it->second, msg);
+    } else if (head->type == kim::LOG_BIN_TEXT) {
+        print_line(head, nullptr, std::string(data, len));
+    }
+}
+
+static bool decode_file(FILE* fp) {
+    size_t len, pos = 0, skip = 0;
+    kim::log_bin_head_t head;
+    std::vector<char> buf;
+    char rbuf[64 * 1024];
+
+    while ((len = fread(rbuf, 1, sizeof(rbuf), fp)) > 0) {
+        buf.insert(buf.end(), rbuf, rbuf + len);
+
+        while (buf.size() - pos >= sizeof(head)) {
+            memcpy(&head, &buf[pos], sizeof(head));
+            if (head.magic != LOG_BIN_MAGIC || head.len < sizeof(head)) {
+                /* broken record, find next one. */
+                pos++;
+                skip++;
+                continue;
+            }
+            if (buf.size() - pos < head.len) {
+                break;
+            }
+            handle_record(&head, &buf[pos + sizeof(head)], head.len - sizeof(head));
+            pos += head.len;
+        }
+
+        buf.erase(buf.begin(), buf.begin() + pos);
+        pos = 0;
+    }
+
+    if (skip > 0 || !buf.empty()) {
+        fprintf(stderr, "skip broken bytes: %lu, incomplete bytes: %lu\n", skip, buf.size());
+    }
+    return skip == 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <binary log file>... ('-': stdin)\n", argv[0]);
+        return 1;
+    }
+
+    int ret = 0;
+    for (int i = 1; i < argc; i++) {
+        FILE* fp = (strcmp(argv[i], "-") == 0) ? stdin : fopen(argv[i], "rb");
+        if (fp == nullptr) {
+            fprintf(stderr, "open file failed! %s\n", argv[i]);
+            ret = 1;
+            continue;
+        }
+        if (!decode_file(fp)) {
+            ret = 1;
+        }
+        if (fp != stdin) {
+            fclose(fp);
+        }
+    }
+    return ret;
+}
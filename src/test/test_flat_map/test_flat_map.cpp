@@ -0,0 +1,116 @@
+// g++ -g -std='c++11' -I ../../core test_flat_map.cpp ../../core/util/util.cpp -o test_flat_map && ./test_flat_map
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "util/flat_map.h"
+#include "util/util.h"
+
+#define MAX_CNT 200000
+
+#define CHECK(expr)                                                \
+    if (!(expr)) {                                                 \
+        printf("check failed! line: %d, %s\n", __LINE__, #expr); \
+        return false;                                              \
+    }
+
+bool test_int_keys() {
+    kim::FlatMap<uint64_t, int> map;
+    std::unordered_map<uint64_t, int> ref;
+
+    /* random insert and erase, compare with std map. */
+    srand(1);
+    for (int i = 0; i < MAX_CNT; i++) {
+        uint64_t key = rand() % 5000;
+        if (rand() % 3 == 0) {
+            CHECK(map.erase(key) == (ref.erase(key) == 1));
+        } else {
+            CHECK(map.insert(key, i) == ref.insert({key, i}).second);
+        }
+    }
+
+    CHECK(map.size() == ref.size());
+    for (const auto& it : ref) {
+        int* v = map.find(it.first);
+        CHECK(v != nullptr && *v == it.second);
+    }
+
+    size_t cnt = 0;
+    for (auto& it : map) {
+        CHECK(ref.find(it.first) != ref.end());
+        cnt++;
+    }
+    CHECK(cnt == ref.size());
+
+    map.clear();
+    CHECK(map.size() == 0 && map.find(1) == nullptr);
+    return true;
+}
+
+bool test_str_keys() {
+    kim::FlatMap<std::string, int> map;
+
+    for (int i = 0; i < 1000; i++) {
+        CHECK(map.insert(format_str("sess_%d", i), i));
+    }
+    CHECK(!map.insert("sess_1", 1));
+
+    /* lookup by view, no string is built. */
+    const char* buf = "sess_123456";
+    int* v = map.find(kim::StrView(buf, 8));
+    CHECK(v != nullptr && *v == 123);
+    CHECK(map.find(kim::StrView("sess_1000")) == nullptr);
+    CHECK(map.erase(kim::StrView(buf, 8)));
+    CHECK(map.find(std::string("sess_123")) == nullptr);
+    CHECK(map.size() == 999);
+    return true;
+}
+
+bool test_fd_table() {
+    int a = 1, b = 2;
+    kim::FdTable<int> table;
+
+    CHECK(table.get(-1) == nullptr && table.get(100) == nullptr);
+    CHECK(table.set(3, &a) && table.set(5000, &b));
+    CHECK(table.get(3) == &a && table.get(5000) == &b && table.size() == 2);
+
+    int cnt = 0;
+    table.for_each([&](int* p) { table.remove(p == &a ? 3 : 5000); cnt++; });
+    CHECK(cnt == 2 && table.size() == 0 && table.get(3) == nullptr);
+    return true;
+}
+
+void test_speed() {
+    double begin;
+    std::vector<uint64_t> keys;
+    kim::FlatMap<uint64_t, int> map;
+    std::unordered_map<uint64_t, int> ref;
+
+    for (int i = 0; i < MAX_CNT; i++) {
+        keys.push_back(((uint64_t)rand() << 32) | rand());
+    }
+
+    begin = time_now();
+    for (int i = 0; i < MAX_CNT; i++) map.insert(keys[i], i);
+    for (int i = 0; i < MAX_CNT * 5; i++) map.find(keys[i % MAX_CNT]);
+    for (int i = 0; i < MAX_CNT; i++) map.erase(keys[i]);
+    printf("flat map spend time: %f\n", time_now() - begin);
+
+    begin = time_now();
+    for (int i = 0; i < MAX_CNT; i++) ref.insert({keys[i], i});
+    for (int i = 0; i < MAX_CNT * 5; i++) ref.find(keys[i % MAX_CNT]);
+    for (int i = 0; i < MAX_CNT; i++) ref.erase(keys[i]);
+    printf("unordered map spend time: %f\n", time_now() - begin);
+}
+
+int main() {
+    printf("test int keys: %s\n", test_int_keys() ? "ok" : "failed");
+    printf("test str keys: %s\n", test_str_keys() ? "ok" : "failed");
+    printf("test fd table: %s\n", test_fd_table() ? "ok" : "failed");
+    test_speed();
+    return 0;
+}
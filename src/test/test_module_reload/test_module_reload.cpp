@@ -0,0 +1,116 @@
+/* make -C ../../modules/module_test && make && ./test_module_reload [so path]
+ * so is copied to ./modules/, then it is touched and reloaded by repeat timer,
+ * the old generation is kept until its cmd in flight is released. */
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+#include "module_mgr.h"
+#include "server.h"
+#include "util/json/CJsonObject.hpp"
+#include "util/log.h"
+
+#define SO_NAME "module_test.so"
+#define SO_PATH "../../../bin/modules/" SO_NAME
+
+#define CHECK(expr)                                                \
+    if (!(expr)) {                                                 \
+        printf("check failed! line: %d, %s\n", __LINE__, #expr); \
+        return false;                                              \
+    }
+
+/* module mgr only needs seq from net. */
+class TestNet : public kim::INet {
+   public:
+    virtual uint64_t new_seq() override { return ++m_seq; }
+
+   private:
+    uint64_t m_seq = 0;
+};
+
+bool copy_so(const std::string& from, const std::string& to) {
+    std::ifstream in(from, std::ios::binary);
+    std::ofstream out(to, std::ios::binary | std::ios::trunc);
+    if (!in || !out) {
+        return false;
+    }
+    out << in.rdbuf();
+    return out.good();
+}
+
+bool set_mtime(const std::string& path, time_t t) {
+    struct timeval tv[2];
+    tv[0].tv_sec = tv[1].tv_sec = t;
+    tv[0].tv_usec = tv[1].tv_usec = 0;
+    return utimes(path.c_str(), tv) == 0;
+}
+
+bool test_reload(const char* src) {
+    std::string path = work_path() + "/modules/" SO_NAME;
+    mkdir((work_path() + "/modules").c_str(), 0755);
+    CHECK(copy_so(src, path));
+    /* loaded so is older than the touch. */
+    CHECK(set_mtime(path, time(nullptr) - 10));
+
+    kim::Log logger;
+    logger.set_level(kim::Log::LL_INFO);
+    TestNet net;
+    kim::ModuleMgr mgr(0, &logger, &net);
+
+    kim::CJsonObject config;
+    config.Parse("{\"modules\": [\"" SO_NAME "\"], \"module_hot_reload\": true}");
+    CHECK(mgr.init(config));
+
+    kim::Module* module = mgr.get_module(1);
+    CHECK(module != nullptr && module->generation() == 0);
+
+    /* nothing changed. */
+    mgr.on_repeat_timer();
+    CHECK(mgr.get_module(1) == module);
+
+    /* a cmd of generation 0 is in flight. */
+    kim::Module* old = module;
+    old->add_cmd_ref();
+
+    /* touch so, it is reloaded after it has been written for 1 second. */
+    CHECK(utimes(path.c_str(), nullptr) == 0);
+    sleep(2);
+    mgr.on_repeat_timer();
+    module = mgr.get_module(1);
+    CHECK(module != nullptr && module != old && module->generation() == 1);
+
+    /* old generation is retired, not closed. */
+    CHECK(mgr.retired_cnt() == 1);
+    CHECK(old->is_retired() && old->generation() == 0 && old->cmd_cnt() == 1);
+
+    /* not changed again, old one is still retained. */
+    mgr.on_repeat_timer();
+    CHECK(mgr.get_module(1) == module);
+    CHECK(mgr.retired_cnt() == 1);
+
+    /* cmd is released, old so is closed in the next tick. */
+    old->del_cmd_ref();
+    mgr.on_repeat_timer();
+    CHECK(mgr.retired_cnt() == 0);
+    CHECK(mgr.get_module(1) == module);
+
+    unlink(path.c_str());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* src = (argc > 1) ? argv[1] : SO_PATH;
+    if (access(src, F_OK) != 0) {
+        printf("so: %s not exist, pls build module_test first!\n", src);
+        return 1;
+    }
+
+    bool ok = test_reload(src);
+    printf("test module reload %s\n", ok ? "ok" : "failed");
+    return ok ? 0 : 1;
+}
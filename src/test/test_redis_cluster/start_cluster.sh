@@ -0,0 +1,25 @@
+#!/bin/sh
+# start a local redis cluster for test: ./start_cluster.sh [stop]
+work_path=$(dirname $0)
+cd $work_path
+
+ports="7000 7001 7002"
+
+if [ "$1" = "stop" ]; then
+    for port in $ports; do
+        redis-cli -p $port shutdown nosave
+    done
+    rm -rf ./cluster
+    exit 0
+fi
+
+nodes=""
+for port in $ports; do
+    mkdir -p ./cluster/$port
+    redis-server --port $port --cluster-enabled yes --cluster-config-file nodes.conf \
+        --dir ./cluster/$port --appendonly no --save "" --daemonize yes
+    nodes="$nodes 127.0.0.1:$port"
+done
+
+sleep 1
+echo yes | redis-cli --cluster create $nodes --cluster-replicas 0
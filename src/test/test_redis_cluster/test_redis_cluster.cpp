@@ -0,0 +1,130 @@
+/* ./start_cluster.sh && ./test_redis_cluster [host] [port]
+ * key slot is checked offline, cmds are sent to the cluster if it is started. */
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "redis/redis_mgr.h"
+#include "server.h"
+#include "util/json/CJsonObject.hpp"
+#include "util/log.h"
+
+#define KEY_CNT 100
+#define TIMEOUT_VAL 5.0
+
+#define CHECK(expr)                                                \
+    if (!(expr)) {                                                 \
+        printf("check failed! line: %d, %s\n", __LINE__, #expr); \
+        return false;                                              \
+    }
+
+kim::RedisMgr* g_mgr = nullptr;
+struct ev_loop* g_loop = nullptr;
+ev_timer g_timer;
+
+int g_set_ok_cnt = 0;
+int g_get_ok_cnt = 0;
+int g_callback_cnt = 0;
+
+bool test_key_slot() {
+    CHECK(kim::RedisCluster::key_slot("foo", 3) == 12182);
+    CHECK(kim::RedisCluster::key_slot("bar", 3) == 5061);
+    CHECK(kim::RedisCluster::key_slot("123456789", 9) == 0x31C3);
+
+    /* hash tag. */
+    CHECK(kim::RedisCluster::key_slot("{user1000}.following", 20) ==
+          kim::RedisCluster::key_slot("user1000", 8));
+    CHECK(kim::RedisCluster::key_slot("foo{}{bar}", 10) !=
+          kim::RedisCluster::key_slot("bar", 3));
+    CHECK(kim::RedisCluster::key_slot("foo{{bar}}zap", 13) ==
+          kim::RedisCluster::key_slot("{bar", 4));
+
+    CHECK(kim::RedisCluster::key_index({"ping"}) == -1);
+    CHECK(kim::RedisCluster::key_index({"get", "foo"}) == 1);
+    CHECK(kim::RedisCluster::key_index({"eval", "return 1", "0"}) == -1);
+    CHECK(kim::RedisCluster::key_index({"eval", "return 1", "1", "foo"}) == 3);
+    return true;
+}
+
+void on_get_callback(redisAsyncContext* c, void* reply, void* privdata) {
+    redisReply* r = static_cast<redisReply*>(reply);
+    std::string* key = static_cast<std::string*>(privdata);
+    if (r != nullptr && r->type == REDIS_REPLY_STRING && *key == std::string(r->str, r->len)) {
+        g_get_ok_cnt++;
+    }
+    delete key;
+
+    if (++g_callback_cnt == KEY_CNT * 2) {
+        ev_break(g_loop, EVBREAK_ALL);
+    }
+}
+
+void on_set_callback(redisAsyncContext* c, void* reply, void* privdata) {
+    redisReply* r = static_cast<redisReply*>(reply);
+    std::string* key = static_cast<std::string*>(privdata);
+    if (r != nullptr && r->type == REDIS_REPLY_STATUS) {
+        g_set_ok_cnt++;
+    }
+
+    g_callback_cnt++;
+    if (!g_mgr->send_to("test", {"get", *key}, on_get_callback, key)) {
+        delete key;
+        g_callback_cnt++;
+    }
+    if (g_callback_cnt == KEY_CNT * 2) {
+        ev_break(g_loop, EVBREAK_ALL);
+    }
+}
+
+void on_timeout(struct ev_loop* loop, ev_timer* w, int events) {
+    ev_break(loop, EVBREAK_ALL);
+}
+
+bool test_cluster(const char* host, int port) {
+    kim::Log* m_logger = new kim::Log;
+    m_logger->set_log_path("./kimserver.log");
+    m_logger->set_level(kim::Log::LL_DEBUG);
+
+    kim::CJsonObject config;
+    config.Parse(format_str("{\"test\": {\"host\": \"%s\", \"port\": %d, \"conn_cnt\": 2, \"cluster\": true}}",
+                            host, port));
+
+    g_loop = EV_DEFAULT;
+    g_mgr = new kim::RedisMgr(m_logger, g_loop);
+    if (!g_mgr->init(config)) {
+        SAFE_DELETE(g_mgr);
+        SAFE_DELETE(m_logger);
+        return false;
+    }
+
+    /* slot map is not loaded yet, the first cmds are redirected by MOVED. */
+    for (int i = 0; i < KEY_CNT; i++) {
+        std::string* key = new std::string(format_str("key:%d", i));
+        if (!g_mgr->send_to("test", {"set", *key, *key}, on_set_callback, key)) {
+            delete key;
+            g_callback_cnt += 2;
+        }
+    }
+
+    ev_timer_init(&g_timer, on_timeout, TIMEOUT_VAL, 0);
+    ev_timer_start(g_loop, &g_timer);
+    ev_run(g_loop, 0);
+    ev_timer_stop(g_loop, &g_timer);
+
+    SAFE_DELETE(g_mgr);
+    SAFE_DELETE(m_logger);
+
+    printf("set ok: %d/%d, get ok: %d/%d\n", g_set_ok_cnt, KEY_CNT, g_get_ok_cnt, KEY_CNT);
+    return g_set_ok_cnt == KEY_CNT && g_get_ok_cnt == KEY_CNT;
+}
+
+int main(int args, char** argv) {
+    const char* host = (args > 1) ? argv[1] : "127.0.0.1";
+    int port = (args > 2) ? atoi(argv[2]) : 7000;
+
+    printf("test key slot: %s\n", test_key_slot() ? "ok" : "failed");
+    printf("test cluster: %s\n", test_cluster(host, port) ? "ok" : "failed");
+    return 0;
+}
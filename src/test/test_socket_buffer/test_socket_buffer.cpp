@@ -0,0 +1,136 @@
+// g++ -g -std='c++11' -I ../../core test_socket_buffer.cpp ../../core/util/socket_buffer.cpp -o test_socket_buffer && ./test_socket_buffer
+
+#include <sys/socket.h>
+
+#include <iostream>
+
+#include "util/socket_buffer.h"
+#include "util/util.h"
+
+#define MAX_CNT 100000
+
+#define CHECK(expr)                                                \
+    if (!(expr)) {                                                 \
+        printf("check failed! line: %d, %s\n", __LINE__, #expr); \
+        return false;                                              \
+    }
+
+kim::SegmentPool* g_pool = nullptr;
+
+bool test_chain_write_read() {
+    std::string data;
+    kim::SocketBuffer sbuf(g_pool);
+
+    for (int i = 0; i < 3000; i++) {
+        std::string s = format_str("%d,", i);
+        data.append(s);
+        CHECK(sbuf._printf("%d,", i) == (int)s.size());
+    }
+    CHECK(sbuf.readable_len() == data.size());
+    CHECK(sbuf.ToString() == data);
+
+    /* bytes cross segments. */
+    const char* p = sbuf.make_contiguous(5000);
+    CHECK(p != nullptr && std::string(p, 5000) == data.substr(0, 5000));
+    CHECK(sbuf.ToString() == data);
+
+    /* rollback like codec encode failed. */
+    size_t index = sbuf.write_index();
+    sbuf._write("hello world", 11);
+    sbuf.set_write_index(index);
+    CHECK(sbuf.ToString() == data);
+
+    sbuf.skip_bytes(100);
+    data = data.substr(100);
+
+    kim::SocketBuffer dst;
+    CHECK(dst._write(&sbuf, 7000) == 7000);
+    CHECK(dst.ToString() == data.substr(0, 7000));
+    CHECK(sbuf.ToString() == data.substr(7000));
+    return true;
+}
+
+bool test_chain_fd() {
+    int err = 0, fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        return false;
+    }
+
+    std::string data;
+    kim::SocketBuffer wbuf(g_pool), rbuf(g_pool);
+    for (int i = 0; i < 5000; i++) {
+        data.append(format_str("%d,", i));
+    }
+    wbuf._write(data.c_str(), data.size());
+
+    while (wbuf.is_readable()) {
+        CHECK(wbuf.write_fd(fds[0], err) > 0);
+        CHECK(rbuf.read_fd(fds[1], err) > 0);
+    }
+    while (rbuf.readable_len() < data.size()) {
+        CHECK(rbuf.read_fd(fds[1], err) > 0);
+    }
+    CHECK(rbuf.ToString() == data);
+
+    close(fds[0]);
+    close(fds[1]);
+    return true;
+}
+
+bool test_gather_write() {
+    int err = 0, fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        return false;
+    }
+
+    std::string data;
+    kim::SocketBuffer wait_buf, send_buf(g_pool), rbuf(g_pool);
+    for (int i = 0; i < 3000; i++) {
+        std::string s = format_str("%d,", i);
+        (i < 1000) ? wait_buf._write(s.c_str(), s.size()) : send_buf._write(s.c_str(), s.size());
+        data.append(s);
+    }
+
+    /* wait buffer goes first, partial write continues with the rest. */
+    kim::SocketBuffer* bufs[] = {&wait_buf, &send_buf};
+    while (wait_buf.is_readable() || send_buf.is_readable()) {
+        CHECK(kim::SocketBuffer::write_fd(fds[0], bufs, 2, err) > 0);
+    }
+    while (rbuf.readable_len() < data.size()) {
+        CHECK(rbuf.read_fd(fds[1], err) > 0);
+    }
+    CHECK(rbuf.ToString() == data);
+
+    close(fds[0]);
+    close(fds[1]);
+    return true;
+}
+
+void test_speed(kim::SegmentPool* pool) {
+    double begin = time_now();
+    std::string data(1024, 'a');
+    kim::SocketBuffer sbuf(pool);
+
+    for (int i = 0; i < MAX_CNT; i++) {
+        sbuf._write(data.c_str(), data.size());
+        if (sbuf.readable_len() > 64 * 1024) {
+            sbuf.skip_bytes(sbuf.readable_len() - 1024);
+        }
+    }
+    printf("%s buffer, spend time: %f\n", (pool != nullptr) ? "chain" : "flat", time_now() - begin);
+}
+
+int main() {
+    g_pool = new kim::SegmentPool;
+
+    printf("test chain write read: %s\n", test_chain_write_read() ? "ok" : "failed");
+    printf("test chain fd: %s\n", test_chain_fd() ? "ok" : "failed");
+    printf("test gather write: %s\n", test_gather_write() ? "ok" : "failed");
+    test_speed(nullptr);
+    test_speed(g_pool);
+
+    printf("pool free: %lu, alloc: %lu, reuse: %lu\n",
+           g_pool->free_cnt(), g_pool->alloc_cnt(), g_pool->reuse_cnt());
+    delete g_pool;
+    return 0;
+}
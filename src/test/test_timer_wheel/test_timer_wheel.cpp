@@ -0,0 +1,86 @@
+// g++ -g -std='c++11' -I ../../core test_timer_wheel.cpp ../../core/timer_wheel.cpp -o test_timer_wheel && ./test_timer_wheel
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "timer_wheel.h"
+
+#define MAX_CNT 200000
+#define BEGIN_TIME 1600000000.0
+
+#define CHECK(expr)                                                \
+    if (!(expr)) {                                                 \
+        printf("check failed! line: %d, %s\n", __LINE__, #expr); \
+        return false;                                              \
+    }
+
+typedef struct test_timer_s {
+    kim::wheel_timer_t w;
+    double expire;
+    bool is_fired;
+} test_timer_t;
+
+double g_now = BEGIN_TIME;
+int g_fired = 0;
+int g_early = 0;
+int g_late = 0;
+
+void on_timer(kim::wheel_timer_t* w) {
+    test_timer_t* t = static_cast<test_timer_t*>(w->data);
+    t->is_fired = true;
+    g_fired++;
+    if (g_now + 0.000001 < t->expire) {
+        g_early++;
+    } else if (g_now > t->expire + 0.2) {
+        g_late++;
+    }
+}
+
+bool test_add_del_refresh() {
+    kim::TimerWheel wheel;
+    std::vector<test_timer_t> timers(MAX_CNT);
+
+    wheel.start(g_now);
+
+    /* far timers cascade down through every level. */
+    for (int i = 0; i < MAX_CNT; i++) {
+        double secs = (rand() % 2000000) / 100.0;
+        timers[i] = {{nullptr, nullptr, 0, &on_timer, &timers[i]}, g_now + secs, false};
+        wheel.add(&timers[i].w, g_now, secs);
+    }
+    CHECK(wheel.size() == MAX_CNT);
+
+    for (int i = 0; i < MAX_CNT; i += 7) {
+        wheel.del(&timers[i].w);
+        timers[i].expire = -1;
+    }
+
+    for (int i = 3; i < MAX_CNT; i += 11) {
+        if (timers[i].expire > 0) {
+            double secs = (rand() % 100000) / 100.0;
+            timers[i].expire = g_now + secs;
+            wheel.add(&timers[i].w, g_now, secs);
+        }
+    }
+
+    size_t cnt = wheel.size();
+    while (g_now < BEGIN_TIME + 20100) {
+        g_now += 0.05;
+        wheel.run(g_now);
+    }
+
+    CHECK((size_t)g_fired == cnt);
+    CHECK(g_early == 0 && g_late == 0);
+    CHECK(wheel.size() == 0);
+    for (auto& t : timers) {
+        CHECK(t.is_fired == (t.expire > 0));
+    }
+    return true;
+}
+
+int main() {
+    printf("test add del refresh: %s\n", test_add_del_refresh() ? "ok" : "failed");
+    return 0;
+}